@@ -0,0 +1,324 @@
+////////////////////////////////////////////////////////////////////
+//
+// Feature-adaptive Catmull-Clark refinement.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _CCADAPTIVE_HXX
+#define _CCADAPTIVE_HXX 1
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "mydef.h"
+#include "myEigen.hxx"
+
+#include "CCSubFlat.hxx"
+#include "FlatMesh.hxx"
+#include "LimitEvaluator.hxx"
+
+// CCAdaptive は，特異頂点 (valence != 4) と境界の近くの面だけを細分割する．
+//
+// 4 つの角がすべて valence 4 の内部頂点である面は，その 16 個の制御点の
+// 双 3 次 B-spline パッチが極限曲面そのものなので，細分割せずに
+// パッチとして出力する．それ以外の面だけを次のレベルへ細分割し，
+// depth まで細分割しても正則にならない面は四角形として出力する．
+//
+// 各レベルでは，細分割する面の 2-ring (頂点を共有する面をたどって 2 回) の
+// 部分メッシュだけを CCSubFlat で細分割する．外周の頂点は境界として
+// 扱われるので位置が正しくないが，細分割する面の子とその 1-ring には
+// 現れないので出力には使われない．
+//
+// 出力:
+// - mesh()  : 全レベルの頂点 (参照されるものだけ) と depth で残った四角形
+// - patch(i): パッチ i の 16 個の制御点 (4 x 4 格子の行優先, 頂点は mesh() の番号)
+// - patchParam(i): パッチが覆う元の面とその中の領域
+//
+class CCAdaptive {
+ public:
+  // パッチ i の定義域: 元の面 face のパラメータ (u, v) = o + s du + t dv
+  // (s, t は [0, 1]^2 のパッチパラメータ)
+  struct PatchParam {
+    int face;
+    int level;
+    double o[2], du[2], dv[2];
+  };
+
+  CCAdaptive() : uniform_faces_(0), depth_(0), nthreads_(1) { gridOrder(); };
+  ~CCAdaptive(){};
+
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
+  void clear() {
+    mesh_ = FlatMesh();
+    patch_cv_.clear();
+    params_.clear();
+    level_patches_.clear();
+    uniform_faces_ = 0;
+    depth_ = 0;
+  };
+
+  const FlatMesh& mesh() const { return mesh_; };
+  int depth() const { return depth_; };
+
+  int patches_size() const { return (int)params_.size(); };
+  const int* patch(int i) const { return patch_cv_.data() + 16 * i; };
+  const PatchParam& patchParam(int i) const { return params_[i]; };
+
+  // レベル l で出力したパッチ数
+  int levelPatches_size(int l) const { return level_patches_[l]; };
+
+  // mesh を depth まで適応的に細分割する
+  bool apply(const FlatMesh& mesh, int depth) {
+    clear();
+    if (mesh.face_size() != RECTANGLE) {
+      std::cerr << "Error: A non-rectangle face is included. " << std::endl;
+      return false;
+    }
+    depth_ = (depth > 0) ? depth : 0;
+    uniform_faces_ = (long long)mesh.faces_size() << (2 * depth_);
+
+    FlatMesh cur = mesh;
+    std::vector<int> target(mesh.faces_size());
+    std::vector<PatchParam> param(mesh.faces_size());
+    for (int f = 0; f < mesh.faces_size(); ++f) {
+      target[f] = f;
+      param[f] = {f, 0, {0.0, 0.0}, {1.0, 0.0}, {0.0, 1.0}};
+    }
+
+    std::vector<double> points[3];  // 全レベルの頂点
+    std::vector<int> quads;         // depth で残った四角形
+    std::vector<int> idx;
+    for (int l = 0;; ++l) {
+      const int base = (int)points[0].size();
+      for (int d = 0; d < 3; ++d)
+        points[d].insert(points[d].end(), cur.coord(d),
+                         cur.coord(d) + cur.vertices_size());
+      level_patches_.push_back(0);
+
+      FlatTopology topo;
+      topo.build(cur, nthreads_);
+
+      // 正則な面はパッチとして出力し，それ以外を細分割する
+      std::vector<int> refine;
+      std::vector<PatchParam> refine_param;
+      for (int i = 0; i < (int)target.size(); ++i) {
+        const int f = target[i];
+        if (isRegular(topo, f)) {
+          gatherPatch(topo, RECTANGLE * f, idx);
+          for (int k = 0; k < 16; ++k) patch_cv_.push_back(0);
+          int* cv = patch_cv_.data() + patch_cv_.size() - 16;
+          for (int k = 0; k < 16; ++k) cv[grid_[k]] = base + idx[k];
+          params_.push_back(param[i]);
+          params_.back().level = l;
+          ++level_patches_[l];
+        } else if (l == depth_) {
+          for (int k = 0; k < RECTANGLE; ++k) quads.push_back(base + cur.face(f)[k]);
+        } else {
+          refine.push_back(f);
+          refine_param.push_back(param[i]);
+        }
+      }
+      if (refine.empty() || (l == depth_)) break;
+
+      // 細分割する面の 2-ring の部分メッシュを作る
+      std::vector<char> vmark(cur.vertices_size(), 0), fmark(cur.faces_size(), 0);
+      for (int f : refine) fmark[f] = 1;
+      for (int ring = 0; ring <= 2; ++ring) {
+        for (int f = 0; f < cur.faces_size(); ++f)
+          if (fmark[f])
+            for (int k = 0; k < RECTANGLE; ++k) vmark[cur.face(f)[k]] = 1;
+        if (ring == 2) break;
+        for (int v = 0; v < cur.vertices_size(); ++v)
+          if (vmark[v])
+            for (const int* it = topo.voutBegin(v); it != topo.voutEnd(v); ++it)
+              fmark[topo.face(*it)] = 1;
+      }
+
+      std::vector<int> vindex(cur.vertices_size(), -1), findex(cur.faces_size(), -1);
+      int nv = 0, nf = 0;
+      for (int v = 0; v < cur.vertices_size(); ++v)
+        if (vmark[v]) vindex[v] = nv++;
+      for (int f = 0; f < cur.faces_size(); ++f)
+        if (fmark[f]) findex[f] = nf++;
+
+      FlatMesh sub;
+      sub.resize(nv, nf, RECTANGLE);
+      for (int v = 0; v < cur.vertices_size(); ++v)
+        if (vindex[v] >= 0) sub.setPoint(vindex[v], cur.point(v));
+      int* sf = sub.faces().data();
+      for (int f = 0; f < cur.faces_size(); ++f)
+        if (findex[f] >= 0)
+          for (int k = 0; k < RECTANGLE; ++k) *(sf++) = vindex[cur.face(f)[k]];
+
+      CCSubFlat kernel;
+      kernel.setNumThreads(nthreads_);
+      FlatMesh next;
+      if (kernel.apply(sub, next) == false) return false;
+
+      // 細分割した面の子 (CCSubFlat::setSplit() の順に角 j の子が 4 f + j)
+      target.clear();
+      param.clear();
+      for (int i = 0; i < (int)refine.size(); ++i) {
+        for (int j = 0; j < 4; ++j) {
+          target.push_back(4 * findex[refine[i]] + j);
+          param.push_back(childParam(refine_param[i], j));
+        }
+      }
+      cur = std::move(next);
+    }
+
+    // 参照される頂点だけを残す
+    std::vector<int> vindex(points[0].size(), -1);
+    for (int v : patch_cv_) vindex[v] = 0;
+    for (int v : quads) vindex[v] = 0;
+    int nv = 0;
+    for (int& i : vindex)
+      if (i == 0) i = nv++;
+    mesh_.resize(nv, (int)quads.size() / RECTANGLE, RECTANGLE);
+    for (int v = 0; v < (int)vindex.size(); ++v) {
+      if (vindex[v] < 0) continue;
+      for (int d = 0; d < 3; ++d) mesh_.coord(d)[vindex[v]] = points[d][v];
+    }
+    for (int& v : patch_cv_) v = vindex[v];
+    for (int i = 0; i < (int)quads.size(); ++i) mesh_.faces()[i] = vindex[quads[i]];
+    return true;
+  };
+
+  // パッチ i の (s, t) における極限点と法線
+  void evaluate(int i, double s, double t, Eigen::Vector3d& p,
+                Eigen::Vector3d* n = nullptr) const {
+    double bs[4], ds[4], bt[4], dt[4];
+    bspline(s, bs, ds);
+    bspline(t, bt, dt);
+    const int* cv = patch(i);
+    Eigen::Vector3d ps = Eigen::Vector3d::Zero(), pt = Eigen::Vector3d::Zero();
+    p.setZero();
+    for (int j = 0; j < 4; ++j) {
+      for (int k = 0; k < 4; ++k) {
+        const Eigen::Vector3d q = mesh_.point(cv[4 * j + k]);
+        p += bs[k] * bt[j] * q;
+        ps += ds[k] * bt[j] * q;
+        pt += bs[k] * dt[j] * q;
+      }
+    }
+    if (n == nullptr) return;
+    *n = ps.cross(pt);
+    if (n->norm() > 0.0) n->normalize();
+  };
+
+  // 各パッチを tess x tess の四角形に分割し，残った四角形とあわせて out に格納する．
+  // パッチ間で頂点は共有しない (レベルの異なるパッチの境界には T 字の接続が残る)．
+  void tessellate(int tess, FlatMesh& out) const {
+    if (tess < 1) tess = 1;
+    const int np = patches_size();
+    const int pv = (tess + 1) * (tess + 1);
+    out.resize(np * pv + mesh_.vertices_size(), np * tess * tess + mesh_.faces_size(),
+               RECTANGLE);
+    int* fv = out.faces().data();
+    for (int i = 0; i < np; ++i) {
+      const int base = i * pv;
+      for (int j = 0; j <= tess; ++j) {
+        for (int k = 0; k <= tess; ++k) {
+          Eigen::Vector3d p;
+          evaluate(i, (double)k / tess, (double)j / tess, p);
+          out.setPoint(base + j * (tess + 1) + k, p);
+        }
+      }
+      for (int j = 0; j < tess; ++j) {
+        for (int k = 0; k < tess; ++k) {
+          const int a = base + j * (tess + 1) + k;
+          *(fv++) = a;
+          *(fv++) = a + 1;
+          *(fv++) = a + tess + 2;
+          *(fv++) = a + tess + 1;
+        }
+      }
+    }
+    const int base = np * pv;
+    for (int v = 0; v < mesh_.vertices_size(); ++v) out.setPoint(base + v, mesh_.point(v));
+    for (int v : mesh_.faces()) *(fv++) = base + v;
+  };
+
+  // 出力の大きさ (一様に depth 回細分割した場合との比較)
+  void printStats(std::ostream& os) const {
+    os << "cc adaptive (depth " << depth_ << "):";
+    for (int l = 0; l < (int)level_patches_.size(); ++l)
+      os << " L" << l << " " << level_patches_[l];
+    os << " patches, " << mesh_.faces_size() << " quads, "
+       << mesh_.vertices_size() << " vertices (uniform: " << uniform_faces_
+       << " faces)" << std::endl;
+  };
+
+  // 一様に depth 回細分割した場合の面数
+  long long uniformFaces_size() const { return uniform_faces_; };
+
+ private:
+  static bool isRegular(const FlatTopology& topo, int f) {
+    for (int k = 0; k < RECTANGLE; ++k) {
+      const int v = topo.origin(RECTANGLE * f + k);
+      if (topo.isBoundary(v) || (topo.outDegree(v) != 4)) return false;
+    }
+    return true;
+  };
+
+  // 子 j (角 j 側) のパッチ定義域
+  static PatchParam childParam(const PatchParam& p, int j) {
+    static const double c[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+    static const double a[4][2] = {{.5, 0}, {0, .5}, {-.5, 0}, {0, -.5}};
+    static const double b[4][2] = {{0, .5}, {-.5, 0}, {0, -.5}, {.5, 0}};
+    PatchParam q = p;
+    for (int d = 0; d < 2; ++d) {
+      q.o[d] = p.o[d] + c[j][0] * p.du[d] + c[j][1] * p.dv[d];
+      q.du[d] = a[j][0] * p.du[d] + a[j][1] * p.dv[d];
+      q.dv[d] = b[j][0] * p.du[d] + b[j][1] * p.dv[d];
+    }
+    return q;
+  };
+
+  // 一様 3 次 B-spline の基底と微分
+  static void bspline(double t, double* b, double* d) {
+    const double s = 1.0 - t;
+    b[0] = s * s * s / 6.0;
+    b[1] = (3.0 * t * t * t - 6.0 * t * t + 4.0) / 6.0;
+    b[2] = (-3.0 * t * t * t + 3.0 * t * t + 3.0 * t + 1.0) / 6.0;
+    b[3] = t * t * t / 6.0;
+    d[0] = -s * s / 2.0;
+    d[1] = (3.0 * t * t - 4.0 * t) / 2.0;
+    d[2] = (-3.0 * t * t + 2.0 * t + 1.0) / 2.0;
+    d[3] = t * t / 2.0;
+  };
+
+  // gatherPatch() の並び -> 4 x 4 格子の位置
+  // 正則格子の面 0 ([0, 1]^2) で制御点の座標から求める
+  void gridOrder() {
+    FlatMesh wedge;
+    makeWedgeMesh(4, RECTANGLE, 3, wedge);
+    FlatTopology topo;
+    topo.build(wedge);
+    std::vector<int> idx;
+    gatherPatch(topo, 0, idx);
+    for (int k = 0; k < 16; ++k) {
+      const Eigen::Vector3d p = wedge.point(idx[k]);
+      const int i = (int)std::lround(p.x()) + 1;
+      const int j = (int)std::lround(p.y()) + 1;
+      grid_[k] = 4 * j + i;
+    }
+  };
+
+  FlatMesh mesh_;
+  std::vector<int> patch_cv_;        // 16 x patches
+  std::vector<PatchParam> params_;
+  std::vector<int> level_patches_;   // レベルごとのパッチ数
+  long long uniform_faces_;
+  int grid_[16];
+  int depth_;
+  int nthreads_;
+};
+
+#endif  // _CCADAPTIVE_HXX
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////
+//
+// Catmull-Clark subdivision limit-surface evaluation.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _CCLIMIT_HXX
+#define _CCLIMIT_HXX 1
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "mydef.h"
+
+#include "CCMask.hxx"
+#include "CCSubFlat.hxx"
+#include "FlatMesh.hxx"
+#include "LimitEvaluator.hxx"
+
+// LimitEvaluator に渡す Catmull-Clark 細分割の定義
+//
+// 面パラメータ (u, v) は角 0 を原点とし，角 0 から角 1 への方向が u，
+// 角 0 から角 3 への方向が v である．
+struct CCLimitScheme {
+  typedef CCSubFlat Kernel;
+  enum { FaceSize = 4, RegularValence = 4 };
+
+  static const char* name() { return "Catmull-Clark"; };
+
+  // 正則パッチは双 3 次多項式
+  static void monomials(std::vector<std::pair<int, int> >& m) {
+    m.clear();
+    for (int a = 0; a <= 3; ++a)
+      for (int b = 0; b <= 3; ++b) m.emplace_back(a, b);
+  };
+
+  // 2 回細分割した格子点 (i / 4, j / 4)
+  static void samples(std::vector<std::pair<double, double> >& st) {
+    st.clear();
+    for (int i = 0; i <= 4; ++i)
+      for (int j = 0; j <= 4; ++j) st.emplace_back(i / 4.0, j / 4.0);
+  };
+
+  // 角 k を角 0 とするパラメータ
+  static void rotate(int k, double u, double v, double* s, double* t) {
+    switch (k) {
+      case 1: *s = v; *t = 1.0 - u; break;
+      case 2: *s = 1.0 - u; *t = 1.0 - v; break;
+      case 3: *s = 1.0 - v; *t = u; break;
+      default: *s = u; *t = v; break;
+    }
+  };
+
+  // (u, v) を含む子の面 (CCSubFlat::setSplit() の順) と，子の面のパラメータ
+  //   k: (v_k, e_k, f, e_(k-1))
+  static int child(double u, double v, double* s, double* t) {
+    if (u < 0.5) {
+      if (v < 0.5) {
+        *s = 2.0 * u;
+        *t = 2.0 * v;
+        return 0;
+      }
+      *s = 2.0 - 2.0 * v;
+      *t = 2.0 * u;
+      return 3;
+    }
+    if (v < 0.5) {
+      *s = 2.0 * v;
+      *t = 2.0 - 2.0 * u;
+      return 1;
+    }
+    *s = 2.0 - 2.0 * u;
+    *t = 2.0 - 2.0 * v;
+    return 2;
+  };
+
+  // 頂点 v の極限点のマスク
+  //   内部: (n^2 v + 4 sum e_i + sum f_i) / (n (n + 5))
+  //         (e_i: 接続頂点, f_i: 対角頂点)
+  //   境界: (v_a + 4 v + v_b) / 6 (3 次 B-spline 曲線)
+  template <class F>
+  static void limitStencil(const FlatTopology& topo, int v, F&& f) {
+    if (topo.isBoundary(v)) {
+      int a, b;
+      if (topo.boundaryNeighbors(v, &a, &b) == false) {
+        f(v, 1.0);
+        return;
+      }
+      f(v, 4.0 / 6.0);
+      f(a, 1.0 / 6.0);
+      f(b, 1.0 / 6.0);
+      return;
+    }
+    const int n = topo.outDegree(v);
+    if (n < 3) {
+      f(v, 1.0);
+      return;
+    }
+    const double d = 1.0 / (n * (n + 5.0));
+    f(v, n * n * d);
+    for (const int* it = topo.voutBegin(v); it != topo.voutEnd(v); ++it) {
+      f(topo.dest(*it), 4.0 * d);               // connected vertex
+      f(topo.dest(topo.next(*it)), d);          // diagonal vertex
+    }
+  };
+
+  // 頂点 v の 2 つの接ベクトルのマスク (法線は t1 x t2)
+  //   内部: e_i に A_n cos(2 pi i / n),
+  //         f_i に cos(2 pi i / n) + cos(2 pi (i + 1) / n) (sin も同様)
+  //         A_n = 1 + cos(2 pi / n) + cos(pi / n) sqrt(2 (9 + cos(2 pi / n)))
+  //   境界: 接続頂点に Loop と同じ重みを与えた近似 (t1 は境界を横切る方向)
+  template <class F, class G>
+  static void tangentStencils(const FlatTopology& topo, int v, F&& f1, G&& f2) {
+    const int n = topo.outDegree(v);
+    int h = topo.firstOut(v);
+    if (h < 0) return;
+
+    if (topo.isBoundary(v) == false) {
+      const double c = std::cos(2.0 * M_PI / n);
+      const double An = 1.0 + c + std::cos(M_PI / n) * std::sqrt(2.0 * (9.0 + c));
+      for (int i = 0; i < n && h >= 0; ++i, h = topo.ccwOut(h)) {
+        const double a0 = 2.0 * M_PI * i / n, a1 = 2.0 * M_PI * (i + 1) / n;
+        f1(topo.dest(h), An * std::cos(a0));
+        f2(topo.dest(h), An * std::sin(a0));
+        f1(topo.dest(topo.next(h)), std::cos(a0) + std::cos(a1));
+        f2(topo.dest(topo.next(h)), std::sin(a0) + std::sin(a1));
+      }
+      return;
+    }
+
+    // 境界頂点の接続頂点: e_0 (= a), e_1, ..., e_k (= b)
+    std::vector<int> ring;
+    for (; h >= 0; h = topo.ccwOut(h)) {
+      ring.push_back(topo.dest(h));
+      if (topo.ccwOut(h) < 0) ring.push_back(topo.origin(topo.prev(h)));
+    }
+    const int k = (int)ring.size() - 1;
+    if (k < 1) return;
+    if (k == 1) {
+      f1(v, 2.0);
+      f1(ring[0], -1.0);
+      f1(ring[1], -1.0);
+    } else {
+      const double theta = M_PI / k;
+      f1(ring[0], std::sin(theta));
+      f1(ring[k], std::sin(theta));
+      for (int i = 1; i < k; ++i)
+        f1(ring[i], (2.0 * std::cos(theta) - 2.0) * std::sin(i * theta));
+    }
+    f2(ring[0], 1.0);
+    f2(ring[k], -1.0);
+  };
+};
+
+typedef LimitEvaluator<CCLimitScheme> CCLimit;
+
+#endif  // _CCLIMIT_HXX
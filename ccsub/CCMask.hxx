@@ -0,0 +1,29 @@
+////////////////////////////////////////////////////////////////////
+//
+// Catmull-Clark subdivision masks.
+//
+// Copyright (c) 2022-2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _CCMASK_HXX
+#define _CCMASK_HXX 1
+
+// masks
+
+#define CC_MASK_EVEN_VV 1.5   // connected vertex
+#define CC_MASK_EVEN_VA .25   // diagonal vertex
+#define CC_MASK_EVEN_VC 1.75  // center vertex
+
+#define CC_MASK_EDGE_VA .0625
+#define CC_MASK_EDGE_VV .375
+
+#define CC_MASK_FACE_VV .25
+
+// boundary (cubic B-spline curve)
+#define CC_MASK_BOUNDARY_VC .75
+#define CC_MASK_BOUNDARY_VV .125
+#define CC_MASK_BOUNDARY_EV .5
+
+#endif  // _CCMASK_HXX
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////
+//
+// Index-based Catmull-Clark subdivision kernel on FlatMesh.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _CCSUBFLAT_HXX
+#define _CCSUBFLAT_HXX 1
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "mydef.h"
+#include "myEigen.hxx"
+
+#include "CCMask.hxx"
+#include "CCSubSIMD.hxx"
+#include "FlatArena.hxx"
+#include "FlatMesh.hxx"
+
+// CCSubFlat は CCSubL と同じ Catmull-Clark 細分割を FlatMesh 上で行う．
+// 入力は四角形メッシュのみとする．
+//
+// 細分割後の頂点の並びは CCSubL と同じく
+//   [0, nv)                 : even vertex (元の頂点 v に対応)
+//   [nv, nv + ne)           : edge vertex (元のエッジ e に対応)
+//   [nv + ne, nv + ne + nf) : face vertex (元の面 f に対応)
+// である．
+//
+// setNumThreads() で 2 以上を指定すると，各ループを連続区間に分けて
+// 並列に処理する (結果はスレッド数によらずビット単位で一致する)．
+//
+// setStencil() は，CPU が対応していれば CCSubSIMD (AVX2 / SSE2) で計算する．
+// setVectorize(false) のときは 1 点ずつステンシルを適用する．両者の結果は
+// 丸め誤差の範囲で一致する．CCSubSIMD が使う角の値の配列 (corner_) は
+// レベルをまたいで使い回す．
+class CCSubFlat {
+ public:
+  CCSubFlat() : corner_size_(0), nthreads_(1), vectorize_(true){};
+  ~CCSubFlat(){};
+
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
+  void setVectorize(bool f) { vectorize_ = f; };
+  bool isVectorize() const { return vectorize_; };
+
+  const FlatTopology& topology() const { return topo_; };
+
+  // mesh を 1 回細分割して submesh に格納する
+  bool apply(const FlatMesh& mesh, FlatMesh& submesh) {
+    if (init(mesh) == false) return false;
+    setSplit(mesh, submesh);
+    setStencil(mesh, submesh);
+    return true;
+  };
+
+  // mesh を levels 回細分割して submesh に格納する．
+  // 途中のレベルは 2 つの FlatArena を交互に使うので，同時に保持するのは
+  // 細分割元と細分割先の 2 レベル分だけである (subdivideLevels())．
+  bool apply(const FlatMesh& mesh, FlatMesh& submesh, int levels) {
+    return subdivideLevels(*this, mesh, submesh, levels, &stats_);
+  };
+
+  // 直前の apply(levels) の途中のレベルごとの配列の使用量
+  const std::vector<FlatLevelStats>& levelStats() const { return stats_; };
+
+  // r は位相の配列を確保するメモリ資源
+  bool init(const FlatMesh& mesh,
+            std::pmr::memory_resource* r = std::pmr::get_default_resource()) {
+    if (mesh.face_size() != RECTANGLE) {
+      std::cerr << "Error: A non-rectangle face is included. " << std::endl;
+      return false;
+    }
+    topo_.build(mesh, nthreads_, r);
+    return true;
+  };
+
+  // 4-to-1 分割の面を生成する
+  void setSplit(const FlatMesh& mesh, FlatMesh& submesh) {
+    const int nv = mesh.vertices_size();
+    const int ne = topo_.edges_size();
+    const int nf = mesh.faces_size();
+    submesh.resize(nv + ne + nf, 4 * nf, RECTANGLE);
+
+    const int* fv = mesh.faces().data();
+    int* sf = submesh.faces().data();
+    parallelFor(nf, nthreads_, [&](int begin, int end) {
+      for (int f = begin; f < end; ++f) {
+        const int h = 4 * f;
+        const int fp = nv + ne + f;
+        int* c = sf + 16 * f;
+        for (int k = 0; k < 4; ++k) {
+          // v_k, e_k (v_k - v_k+1), face vertex, e_k-1 (v_k-1 - v_k)
+          c[4 * k] = fv[h + k];
+          c[4 * k + 1] = nv + topo_.edge(h + k);
+          c[4 * k + 2] = fp;
+          c[4 * k + 3] = nv + topo_.edge(h + ((k + 3) & 3));
+        }
+      }
+    });
+  };
+
+  // even / edge / face vertex の位置を計算する
+  void setStencil(const FlatMesh& mesh, FlatMesh& submesh) {
+    if (vectorize_ && setStencilSIMD(mesh, submesh)) return;
+
+    const int nv = mesh.vertices_size();
+    const int ne = topo_.edges_size();
+    const double* x = mesh.coord(0);
+    const double* y = mesh.coord(1);
+    const double* z = mesh.coord(2);
+    double* sx = submesh.coord(0);
+    double* sy = submesh.coord(1);
+    double* sz = submesh.coord(2);
+
+    // even vertex points
+    parallelFor(nv, nthreads_, [&](int begin, int end) {
+      for (int v = begin; v < end; ++v) {
+        double px = 0.0, py = 0.0, pz = 0.0;
+        evenStencil(v, [&](int c, double w) {
+          px += w * x[c];
+          py += w * y[c];
+          pz += w * z[c];
+        });
+        sx[v] = px; sy[v] = py; sz[v] = pz;
+      }
+    });
+
+    // edge vertex points
+    parallelFor(ne, nthreads_, [&](int begin, int end) {
+      for (int e = begin; e < end; ++e) {
+        double px = 0.0, py = 0.0, pz = 0.0;
+        edgeStencil(e, [&](int c, double w) {
+          px += w * x[c];
+          py += w * y[c];
+          pz += w * z[c];
+        });
+        sx[nv + e] = px; sy[nv + e] = py; sz[nv + e] = pz;
+      }
+    });
+
+    // face vertex points
+    parallelFor(mesh.faces_size(), nthreads_, [&](int begin, int end) {
+      for (int f = begin; f < end; ++f) {
+        double px = 0.0, py = 0.0, pz = 0.0;
+        faceStencil(f, [&](int c, double w) {
+          px += w * x[c];
+          py += w * y[c];
+          pz += w * z[c];
+        });
+        const int i = nv + ne + f;
+        sx[i] = px; sy[i] = py; sz[i] = pz;
+      }
+    });
+  };
+
+  // 細分割後の頂点数
+  int subVertices_size() const {
+    return topo_.vertices_size() + topo_.edges_size() + topo_.faces_size();
+  };
+
+  // 細分割後の頂点 i のステンシル (init() の後に呼ぶ)
+  template <class F>
+  void stencil(int i, F&& f) const {
+    const int nv = topo_.vertices_size();
+    const int ne = topo_.edges_size();
+    if (i < nv)
+      evenStencil(i, f);
+    else if (i < nv + ne)
+      edgeStencil(i - nv, f);
+    else
+      faceStencil(i - nv - ne, f);
+  };
+
+  // even vertex v のステンシル: f(頂点番号, 重み) を重みの数だけ呼ぶ
+  template <class F>
+  void evenStencil(int v, F&& f) const {
+    if (topo_.isBoundary(v)) {
+      int a, b;
+      if (topo_.boundaryNeighbors(v, &a, &b) == false) {
+        f(v, 1.0);
+        return;
+      }
+      f(v, CC_MASK_BOUNDARY_VC);
+      f(a, CC_MASK_BOUNDARY_VV);
+      f(b, CC_MASK_BOUNDARY_VV);
+      return;
+    }
+    const int n = topo_.outDegree(v);
+    if (n < 3) {
+      f(v, 1.0);
+      return;
+    }
+    const double dn = (double)n;
+    const double wv = CC_MASK_EVEN_VV / (dn * dn);
+    const double wa = CC_MASK_EVEN_VA / (dn * dn);
+    f(v, 1.0 - CC_MASK_EVEN_VC / dn);
+    for (const int* it = topo_.voutBegin(v); it != topo_.voutEnd(v); ++it) {
+      f(topo_.dest(*it), wv);              // connected vertex
+      f(topo_.dest(topo_.next(*it)), wa);  // diagonal vertex
+    }
+  };
+
+  // edge vertex (エッジ e) のステンシル
+  template <class F>
+  void edgeStencil(int e, F&& f) const {
+    const int h = topo_.edgeHalfedge(e);
+    const int m = topo_.mate(h);
+    if (m < 0) {
+      f(topo_.origin(h), CC_MASK_BOUNDARY_EV);
+      f(topo_.dest(h), CC_MASK_BOUNDARY_EV);
+      return;
+    }
+    f(topo_.origin(h), CC_MASK_EDGE_VV);
+    f(topo_.dest(h), CC_MASK_EDGE_VV);
+    f(topo_.dest(topo_.next(h)), CC_MASK_EDGE_VA);
+    f(topo_.origin(topo_.prev(h)), CC_MASK_EDGE_VA);
+    f(topo_.dest(topo_.next(m)), CC_MASK_EDGE_VA);
+    f(topo_.origin(topo_.prev(m)), CC_MASK_EDGE_VA);
+  };
+
+  // face vertex (面 f) のステンシル
+  template <class F>
+  void faceStencil(int fc, F&& f) const {
+    const int h = 4 * fc;
+    for (int k = 0; k < 4; ++k) f(topo_.origin(h + k), CC_MASK_FACE_VV);
+  };
+
+ private:
+  bool setStencilSIMD(const FlatMesh& mesh, FlatMesh& submesh) {
+    if (CCSubSIMD::isa() == CCSubSIMD::None) return false;
+    // 角の値はすべて face の計算で書き込むので初期化しない
+    const size_t n = 4 * mesh.faces().size();
+    if (corner_size_ < n) {
+      corner_.reset(new double[n]);
+      corner_size_ = n;
+    }
+    CCSubSIMD::Args a;
+    for (int d = 0; d < 3; ++d) {
+      a.x[d] = mesh.coord(d);
+      a.s[d] = submesh.coord(d);
+    }
+    a.corner = corner_.get();
+    a.fv = mesh.faces().data();
+    a.mate = topo_.mates().data();
+    a.edge_he = topo_.edgeHalfedges().data();
+    a.vout_offset = topo_.voutOffsets().data();
+    a.vout = topo_.vout().data();
+    a.vout_index = topo_.voutIndices().data();
+    a.is_boundary = topo_.boundaryFlags().data();
+    a.nv = mesh.vertices_size();
+    a.ne = topo_.edges_size();
+    a.nf = mesh.faces_size();
+    return CCSubSIMD::apply(a, nthreads_);
+  };
+
+  FlatTopology topo_;
+  std::unique_ptr<double[]> corner_;  // CCSubSIMD の角の値 (x, y, z, 0)
+  size_t corner_size_;
+  std::vector<FlatLevelStats> stats_;
+  int nthreads_;
+  bool vectorize_;
+};
+
+#endif  // _CCSUBFLAT_HXX
@@ -25,16 +25,12 @@
 #include "VertexLCirculator.hxx"
 #include "MeshUtiL.hxx"
 
-// masks
-
-#define CC_MASK_EVEN_VV 1.5   // connected vertex
-#define CC_MASK_EVEN_VA .25   // diagonal vertex
-#define CC_MASK_EVEN_VC 1.75  // center vertex
-
-#define CC_MASK_EDGE_VA .0625
-#define CC_MASK_EDGE_VV .375
-
-#define CC_MASK_FACE_VV .25
+#include "CCMask.hxx"
+#include "FlatMeshL.hxx"
+#include "CCAdaptive.hxx"
+#include "CCLimit.hxx"
+#include "CCSubFlat.hxx"
+#include "SubdivOperator.hxx"
 
 class CCSubL {
   // original mesh
@@ -48,10 +44,13 @@ class CCSubL {
   std::vector<std::shared_ptr<VertexL>> edvt_;  // edge vertex
   std::vector<std::shared_ptr<VertexL>> fcvt_;  // face vertex
 
+  // number of threads for the flat kernels
+  int nthreads_;
+
  public:
-  CCSubL() : mesh_(nullptr), submesh_(nullptr){};
-  CCSubL(MeshL& mesh) : submesh_(nullptr) { setMesh(mesh); };
-  CCSubL(MeshL& mesh, MeshL& submesh) {
+  CCSubL() : mesh_(nullptr), submesh_(nullptr), nthreads_(1){};
+  CCSubL(MeshL& mesh) : submesh_(nullptr), nthreads_(1) { setMesh(mesh); };
+  CCSubL(MeshL& mesh, MeshL& submesh) : nthreads_(1) {
     setMesh(mesh);
     setSubMesh(submesh);
   };
@@ -60,6 +59,11 @@ class CCSubL {
   void setMesh(MeshL& mesh) { mesh_ = &mesh; };
   void setSubMesh(MeshL& mesh) { submesh_ = &mesh; };
 
+  // 配列上の細分割 (CCSubFlat など) のスレッド数 (1 のときは逐次処理)．
+  // setStencil() は演習のコードなので逐次処理のままである
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
   bool emptyMesh() const { return (mesh_ != nullptr) ? false : true; };
   bool emptySubMesh() const { return (submesh_ != nullptr) ? false : true; };
 
@@ -72,6 +76,109 @@ class CCSubL {
               << " f " << submesh_->faces_size() << std::endl;
   };
 
+  // levels 回の細分割を一度に行う．
+  // CCSubFlat により配列上で細分割し，途中のレベルは 2 つのバッファを
+  // 交互に使って計算する．MeshL は最終レベルの submesh だけを構築する．
+  void apply(int levels) {
+    if (emptyMesh()) return;
+    if (emptySubMesh()) return;
+
+    FlatMesh flat, subflat;
+    if (flatFromMeshL(*mesh_, RECTANGLE, flat) == false) return;
+
+    CCSubFlat ccflat;
+    ccflat.setNumThreads(nthreads_);
+    if (ccflat.apply(flat, subflat, levels) == false) return;
+    flat = FlatMesh();  // MeshL の構築前に入力側の配列を解放する
+
+    flatToMeshL(subflat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    std::cout << "cc subdiv. (level " << levels << "): done. v "
+              << submesh_->vertices_size() << " f " << submesh_->faces_size()
+              << std::endl;
+  };
+
+  // mesh の位相から levels 回分の細分割行列を op に作る．
+  // 位相が変わらない限り，op は applyOperator() で何度でも使える．
+  bool buildOperator(int levels, SubdivOperator& op) {
+    if (emptyMesh()) return false;
+
+    FlatMesh flat;
+    if (flatFromMeshL(*mesh_, RECTANGLE, flat) == false) return false;
+
+    op.setNumThreads(nthreads_);
+    return op.build<CCSubFlat>(flat, levels);
+  };
+
+  // mesh の現在の頂点位置を op で細分割し，submesh に格納する．
+  // submesh が空のときは面も作り，そうでなければ頂点位置だけを更新する．
+  // op が mesh の頂点数と合わない場合は false を返す．
+  bool applyOperator(const SubdivOperator& op) {
+    if (emptyMesh()) return false;
+    if (emptySubMesh()) return false;
+
+    FlatMesh flat, subflat;
+    flat.resize(mesh_->vertices_size(), 0, RECTANGLE);
+    flatPointsFromMeshL(*mesh_, flat);
+    if (op.apply(flat, subflat) == false) return false;
+
+    if (submesh_->vertices_size() == 0)
+      flatToMeshL(subflat, *submesh_);
+    else
+      flatPointsToMeshL(subflat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    return true;
+  };
+
+  // 特異頂点と境界の近くだけを depth まで細分割する (CCAdaptive)．
+  // 正則な領域はパッチとして adaptive に残し，submesh には各パッチを
+  // tess x tess に分割した四角形と残りの四角形を格納する．
+  bool applyAdaptive(int depth, CCAdaptive& adaptive, int tess = 1) {
+    if (emptyMesh()) return false;
+    if (emptySubMesh()) return false;
+
+    FlatMesh flat;
+    if (flatFromMeshL(*mesh_, RECTANGLE, flat) == false) return false;
+
+    adaptive.setNumThreads(nthreads_);
+    if (adaptive.apply(flat, depth) == false) return false;
+    adaptive.printStats(std::cout);
+
+    FlatMesh tessmesh;
+    adaptive.tessellate(tess, tessmesh);
+    flatToMeshL(tessmesh, *submesh_);
+    submesh_->calcAllFaceNormals();
+    return true;
+  };
+
+  // mesh の極限曲面を評価する limit を用意する．
+  // limit.evaluate(f, u, v) の面番号 f は mesh.faces() の走査順，
+  // 頂点番号は mesh.vertices() の走査順である．
+  bool buildLimit(CCLimit& limit) {
+    if (emptyMesh()) return false;
+
+    FlatMesh flat;
+    if (flatFromMeshL(*mesh_, RECTANGLE, flat) == false) return false;
+    return limit.setMesh(flat);
+  };
+
+  // mesh の頂点を極限曲面上へ射影したメッシュを submesh に作る．
+  // 頂点ごとに閉じた形のマスクを 1 回適用するだけで，細分割は行わない．
+  void projectToLimit() {
+    if (emptyMesh()) return;
+    if (emptySubMesh()) return;
+
+    CCLimit limit;
+    if (buildLimit(limit) == false) return;
+    FlatMesh flat;
+    limit.projectToLimit(flat);
+
+    flatToMeshL(flat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    std::cout << "cc limit: done. v " << submesh_->vertices_size()
+              << " f " << submesh_->faces_size() << std::endl;
+  };
+
   // bool init();
   bool init() {
     if (emptyMesh()) return false;
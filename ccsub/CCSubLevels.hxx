@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////
+//
+// Background computation of Catmull-Clark subdivision levels.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _CCSUBLEVELS_HXX
+#define _CCSUBLEVELS_HXX 1
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "MeshL.hxx"
+
+#include "CCSubL.hxx"
+#include "FlatMeshL.hxx"
+
+// CCSubLevels は，細分割レベル 0, 1, 2, ... の MeshL を保持し，
+// 次のレベルをワーカースレッドで計算する．
+//
+// 描画ループからは毎フレーム poll() を呼ぶだけでよく，計算中も
+// 表示中のレベルはそのまま描画できる．
+//
+// ワーカーは既定では CCSubL::apply() (setSplit() / setStencil() の演習のコード)
+// で細分割する．apply() は init() で mesh の接続情報を作り直すので，
+// 計算済みの最後のレベルをワーカー側で複製してから細分割する．
+// setFlat(true) のときは CCSubL::apply(1) (配列上の細分割) を使う．
+// こちらは最後のレベルを読むだけで書き換えないので，複製しない．
+//
+// speculative を有効にすると，表示中のレベルの次のレベルを要求される前に
+// 計算しておく (面数が limit を超える場合は行わない)．
+class CCSubLevels {
+ public:
+  CCSubLevels()
+      : nthreads_(1), flat_(false), speculative_(false),
+        speculative_limit_(0), pending_level_(-1){};
+  ~CCSubLevels() { wait(); };
+
+  void setBase(std::shared_ptr<MeshL> mesh) {
+    wait();
+    meshes_.clear();
+    meshes_.push_back(mesh);
+  };
+
+  // 細分割のスレッド数 (配列上の細分割のときだけ使う)
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+
+  // true なら配列上の細分割 (CCSubFlat) を使う
+  void setFlat(bool f) { flat_ = f; };
+  bool isFlat() const { return flat_; };
+
+  // 面数が limit 以下になるレベルまで先読みする
+  void setSpeculative(bool f, int limit) {
+    speculative_ = f;
+    speculative_limit_ = limit;
+  };
+
+  // 計算済みのレベル数
+  int size() const { return (int)meshes_.size(); };
+  std::shared_ptr<MeshL> level(int k) const { return meshes_[k]; };
+
+  // 計算中のレベル (なければ -1)
+  int pendingLevel() const { return pending_level_; };
+  bool isBusy() const { return pending_level_ >= 0; };
+
+  // レベル k を要求する．計算済みなら true を返す．
+  // そうでなければ次のレベルの計算を始めて (計算中なら何もしない) false を返す．
+  bool request(int k) {
+    if (k < size()) return true;
+    start();
+    return false;
+  };
+
+  // 計算が終わっていれば結果を取り込んで true を返す．待たずに戻る．
+  // display は表示中のレベルで，先読みの判定に使う．
+  bool poll(int display) {
+    bool done = false;
+    if (isBusy() &&
+        (pending_.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+      done = finish();
+    if (speculative_ && (isBusy() == false) && (display + 1 == size()) &&
+        (4LL * meshes_.back()->faces_size() <= speculative_limit_))
+      start();
+    return done;
+  };
+
+  // 計算中のレベルを待つ
+  void wait() {
+    if (isBusy()) finish();
+  };
+
+ private:
+  void start() {
+    if (isBusy() || meshes_.empty()) return;
+    std::shared_ptr<MeshL> src = meshes_.back();
+    const int nthreads = nthreads_;
+    const bool flat = flat_;
+    pending_level_ = size();
+    pending_ = std::async(std::launch::async, [src, nthreads, flat]() {
+      std::shared_ptr<MeshL> dst = std::make_shared<MeshL>();
+      if (flat) {
+        CCSubL ccsub(*src, *dst);
+        ccsub.setNumThreads(nthreads);
+        ccsub.apply(1);
+        return dst;
+      }
+
+      // 描画中の src の接続情報を書き換えないように複製を細分割する
+      FlatMesh snapshot;
+      if (flatFromMeshL(*src, RECTANGLE, snapshot) == false) return dst;
+      MeshL copy;
+      flatToMeshL(snapshot, copy);
+      copy.createConnectivity(true);
+      CCSubL ccsub(copy, *dst);
+      ccsub.apply();
+      return dst;
+    });
+  };
+
+  bool finish() {
+    std::shared_ptr<MeshL> mesh = pending_.get();
+    pending_level_ = -1;
+    if (mesh->faces_size() == 0) {
+      // 細分割できないメッシュ (四角形以外の面を含むなど) は先読みもやめる
+      speculative_ = false;
+      return false;
+    }
+    meshes_.push_back(mesh);
+    return true;
+  };
+
+  std::vector<std::shared_ptr<MeshL> > meshes_;
+  std::future<std::shared_ptr<MeshL> > pending_;
+  int nthreads_;
+  bool flat_;
+  bool speculative_;
+  long long speculative_limit_;
+  int pending_level_;
+};
+
+#endif  // _CCSUBLEVELS_HXX
@@ -0,0 +1,423 @@
+////////////////////////////////////////////////////////////////////
+//
+// Vectorized Catmull-Clark stencil kernels (AVX2 / SSE2).
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _CCSUBSIMD_HXX
+#define _CCSUBSIMD_HXX 1
+
+#include <algorithm>
+#include <cstring>
+
+#include "CCMask.hxx"
+#include "ParallelFor.hxx"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CCSUB_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(CCSUB_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CCSUB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CCSUB_TARGET_AVX2
+#endif
+
+// CCSubSIMD は，CCSubFlat::setStencil() と同じ位置を SIMD 命令でまとめて計算する．
+//
+// 座標は FlatMesh と同じ structure-of-arrays で，出力点 4 個 (AVX2) または
+// 2 個 (SSE2) を 1 命令で処理する．使う命令セットは実行時に CPU を調べて決める．
+//
+// 隣接頂点のたどり方を減らすため，face vertex を先に計算し，
+// edge / even vertex はそれを使った等価な式で求める:
+//   face: F = (v0 + v1 + v2 + v3) / 4,  角 h の値 q_h = x[origin(h)] + F
+//   edge: E = (q_h + q_mate(h)) / 4                (境界: (a + b) / 2)
+//   even: V = ((n - 2) v + sum q / n) / n          (q: v に入るハーフエッジの角の値)
+// これは CCMask.hxx のマスクを展開したものと同じである (丸め誤差の範囲で一致)．
+//
+// face の計算で，角 h の値 q_h を (x, y, z, 0) の 4 個組として corner の
+// vout_index[next(h)] の位置 (vout の並び) に書き込む．これで頂点 v の q は
+// corner の [vout_offset[v], vout_offset[v + 1]) に連続して並び，edge / even vertex は
+// 座標の gather を使わずに 1 命令で 1 つの角の値を読める．内部の価数 4 の頂点が
+// 4 個続くところは 16 個の連続した角の値を読んでまとめて処理し，
+// それ以外の頂点は 1 個ずつ処理する．
+class CCSubSIMD {
+ public:
+  // 細分割元の配列 (FlatTopology と同じもの) と細分割先の座標
+  struct Args {
+    const double* x[3];  // 細分割元の座標 (SoA)
+    double* s[3];        // 細分割先の座標 (SoA)
+    const int* fv;       // 面の頂点 (四角形)
+    const int* mate;
+    const int* edge_he;
+    const int* vout_offset;
+    const int* vout;
+    const char* is_boundary;
+    const int* vout_index;  // ハーフエッジの vout での位置
+    double* corner;         // 角の値 (x, y, z, 0)，大きさは 4 * ハーフエッジ数
+    int nv, ne, nf;
+  };
+
+  enum { None = 0, SSE2 = 1, AVX2 = 2 };
+
+  // 使える命令セット (None, SSE2, AVX2)
+  static int isa() {
+    static const int level = detect();
+    return level;
+  };
+  static const char* isaName(int l) {
+    return (l == AVX2) ? "AVX2" : (l == SSE2) ? "SSE2" : "none";
+  };
+
+  // face, edge, even vertex の順に計算する．l は isa() 以下であること．
+  static bool apply(const Args& a, int nthreads, int l = isa()) {
+    if ((l <= None) || (l > isa())) return false;
+    const int width = (l == AVX2) ? 4 : 2;
+    run(a.nf, width, nthreads, [&](int b, int e) {
+      if (l == AVX2) faceAVX2(a, b, e); else faceSSE2(a, b, e);
+    });
+    run(a.ne, width, nthreads, [&](int b, int e) {
+      if (l == AVX2) edgeAVX2(a, b, e); else edgeSSE2(a, b, e);
+    });
+    run(a.nv, width, nthreads, [&](int b, int e) {
+      if (l == AVX2) evenAVX2(a, b, e); else evenSSE2(a, b, e);
+    });
+    return true;
+  };
+
+ private:
+  static int detect() {
+#if defined(CCSUB_SIMD_X86)
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuid(r, 0);
+    if (r[0] >= 7) {
+      __cpuid(r, 1);
+      const bool osxsave = (r[2] & (1 << 27)) != 0;
+      const bool avx = (r[2] & (1 << 28)) != 0;
+      __cpuidex(r, 7, 0);
+      if (osxsave && avx && (r[1] & (1 << 5)) &&
+          ((_xgetbv(0) & 6) == 6))
+        return AVX2;
+    }
+    return SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return AVX2;
+    return SSE2;
+#endif
+#else
+    return None;
+#endif
+  };
+
+  // [0, n) を width の倍数の区間に分けて並列に処理する
+  template <class F>
+  static void run(int n, int width, int nthreads, F&& f) {
+    const int blocks = (n + width - 1) / width;
+    parallelFor(blocks, nthreads, [&](int b0, int b1) {
+      f(b0 * width, std::min(b1 * width, n));
+    });
+  };
+
+  static int next(int h) { return (h & ~3) | ((h + 1) & 3); };
+  static int prev(int h) { return (h & ~3) | ((h + 3) & 3); };
+
+  // 1 点ずつの計算 (端数と特殊な頂点)
+  static void faceScalar(const Args& a, int f) {
+    const int* c = a.fv + 4 * f;
+    int sl[4];
+    for (int k = 0; k < 4; ++k) sl[k] = 4 * a.vout_index[next(4 * f + k)];
+    for (int d = 0; d < 3; ++d) {
+      const double* x = a.x[d];
+      const double p = CC_MASK_FACE_VV * (x[c[0]] + x[c[1]] + x[c[2]] + x[c[3]]);
+      a.s[d][a.nv + a.ne + f] = p;
+      for (int k = 0; k < 4; ++k) a.corner[sl[k] + d] = x[c[k]] + p;
+    }
+    for (int k = 0; k < 4; ++k) a.corner[sl[k] + 3] = 0.0;
+  };
+
+  static void edgeScalar(const Args& a, int e) {
+    const int h = a.edge_he[e];
+    const int m = a.mate[h];
+    const int p = a.fv[h], q = a.fv[next(h)];
+    for (int d = 0; d < 3; ++d) {
+      const double* x = a.x[d];
+      if (m < 0)
+        a.s[d][a.nv + e] = CC_MASK_BOUNDARY_EV * (x[p] + x[q]);
+      else
+        a.s[d][a.nv + e] = 0.25 * (a.corner[4 * a.vout_index[next(h)] + d] +
+                                   a.corner[4 * a.vout_index[next(m)] + d]);
+    }
+  };
+
+  static void evenScalar(const Args& a, int v) {
+    const int b0 = a.vout_offset[v], b1 = a.vout_offset[v + 1];
+    const int n = b1 - b0;
+    if (a.is_boundary[v]) {
+      int p = -1, q = -1;
+      for (int i = b0; i < b1; ++i) {
+        const int h = a.vout[i];
+        if (a.mate[h] < 0) p = a.fv[next(h)];
+        if (a.mate[prev(h)] < 0) q = a.fv[prev(h)];
+      }
+      for (int d = 0; d < 3; ++d) {
+        const double* x = a.x[d];
+        a.s[d][v] = ((p < 0) || (q < 0))
+                        ? x[v]
+                        : CC_MASK_BOUNDARY_VC * x[v] + CC_MASK_BOUNDARY_VV * (x[p] + x[q]);
+      }
+      return;
+    }
+    if (n < 3) {
+      for (int d = 0; d < 3; ++d) a.s[d][v] = a.x[d][v];
+      return;
+    }
+    const double dn = (double)n;
+    for (int d = 0; d < 3; ++d) {
+      double sum = 0.0;
+      for (int i = b0; i < b1; ++i) sum += a.corner[4 * i + d];
+      a.s[d][v] = ((dn - 2.0) * a.x[d][v] + sum / dn) / dn;
+    }
+  };
+
+#if defined(CCSUB_SIMD_X86)
+  //
+  // AVX2: 4 点ずつ
+  //
+  // 4 面分の頂点番号 (面ごとに 4 個) を角ごとの列 c[k] に並べ替える
+  static void transpose4(const int* p, __m128i c[4]) {
+    const __m128i r0 = _mm_loadu_si128((const __m128i*)p);
+    const __m128i r1 = _mm_loadu_si128((const __m128i*)(p + 4));
+    const __m128i r2 = _mm_loadu_si128((const __m128i*)(p + 8));
+    const __m128i r3 = _mm_loadu_si128((const __m128i*)(p + 12));
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    const __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+    c[0] = _mm_unpacklo_epi64(t0, t1);
+    c[1] = _mm_unpackhi_epi64(t0, t1);
+    c[2] = _mm_unpacklo_epi64(t2, t3);
+    c[3] = _mm_unpackhi_epi64(t2, t3);
+  };
+
+  // 4 点分の (x, y, z, *) r[i] を座標ごとの列 (SoA) p[d] に並べ替える
+  CCSUB_TARGET_AVX2 static void toSoA(const __m256d r[4], __m256d p[3]) {
+    const __m256d t0 = _mm256_unpacklo_pd(r[0], r[1]);  // x0 x1 z0 z1
+    const __m256d t1 = _mm256_unpackhi_pd(r[0], r[1]);  // y0 y1 * *
+    const __m256d t2 = _mm256_unpacklo_pd(r[2], r[3]);  // x2 x3 z2 z3
+    const __m256d t3 = _mm256_unpackhi_pd(r[2], r[3]);  // y2 y3 * *
+    p[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+    p[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+    p[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+  };
+
+  CCSUB_TARGET_AVX2 static void faceAVX2(const Args& a, int begin, int end) {
+    const __m256d w = _mm256_set1_pd(CC_MASK_FACE_VV);
+    const __m256d zero = _mm256_setzero_pd();
+    const int fb = a.nv + a.ne;
+    int f = begin;
+    for (; f + 4 <= end; f += 4) {
+      __m128i c[4];
+      transpose4(a.fv + 4 * f, c);
+      __m256d xk[3][4], p[3];
+      for (int d = 0; d < 3; ++d) {
+        const double* x = a.x[d];
+        for (int k = 0; k < 4; ++k) xk[d][k] = _mm256_i32gather_pd(x, c[k], 8);
+        p[d] = _mm256_mul_pd(w, _mm256_add_pd(_mm256_add_pd(xk[d][0], xk[d][1]),
+                                              _mm256_add_pd(xk[d][2], xk[d][3])));
+        _mm256_storeu_pd(a.s[d] + fb + f, p[d]);
+      }
+      // 角の値の位置 4 * vout_index[next(h)] (面ごとに 4 個)
+      alignas(16) int sl[16];
+      for (int i = 0; i < 4; ++i) {
+        const __m128i r = _mm_loadu_si128((const __m128i*)(a.vout_index + 4 * (f + i)));
+        _mm_store_si128((__m128i*)(sl + 4 * i),
+                        _mm_slli_epi32(_mm_shuffle_epi32(r, _MM_SHUFFLE(0, 3, 2, 1)), 2));
+      }
+      // 角 k の値を面ごとの (x, y, z, 0) に並べ替えて書き込む
+      for (int k = 0; k < 4; ++k) {
+        const __m256d qx = _mm256_add_pd(xk[0][k], p[0]);
+        const __m256d qy = _mm256_add_pd(xk[1][k], p[1]);
+        const __m256d qz = _mm256_add_pd(xk[2][k], p[2]);
+        const __m256d t0 = _mm256_unpacklo_pd(qx, qy);    // x0 y0 x2 y2
+        const __m256d t1 = _mm256_unpackhi_pd(qx, qy);    // x1 y1 x3 y3
+        const __m256d t2 = _mm256_unpacklo_pd(qz, zero);  // z0 0 z2 0
+        const __m256d t3 = _mm256_unpackhi_pd(qz, zero);  // z1 0 z3 0
+        _mm256_storeu_pd(a.corner + sl[k], _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(a.corner + sl[4 + k], _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(a.corner + sl[8 + k], _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(a.corner + sl[12 + k], _mm256_permute2f128_pd(t1, t3, 0x31));
+      }
+    }
+    for (; f < end; ++f) faceScalar(a, f);
+  };
+
+  CCSUB_TARGET_AVX2 static void edgeAVX2(const Args& a, int begin, int end) {
+    const __m256d quarter = _mm256_set1_pd(0.25);
+    const double* c = a.corner;
+    int e = begin;
+    for (; e + 4 <= end; e += 4) {
+      const int* h = a.edge_he + e;
+      const int m0 = a.mate[h[0]], m1 = a.mate[h[1]], m2 = a.mate[h[2]], m3 = a.mate[h[3]];
+      // 境界のエッジ (mate < 0) を含むときは 1 個ずつ処理する
+      if ((m0 | m1 | m2 | m3) < 0) {
+        for (int i = 0; i < 4; ++i) edgeScalar(a, e + i);
+        continue;
+      }
+      const int* vi = a.vout_index;
+      const int m[4] = {m0, m1, m2, m3};
+      __m256d r[4], p[3];
+      for (int i = 0; i < 4; ++i)
+        r[i] = _mm256_add_pd(_mm256_loadu_pd(c + 4 * vi[next(h[i])]),
+                             _mm256_loadu_pd(c + 4 * vi[next(m[i])]));
+      toSoA(r, p);
+      for (int d = 0; d < 3; ++d) _mm256_storeu_pd(a.s[d] + a.nv + e, _mm256_mul_pd(quarter, p[d]));
+    }
+    for (; e < end; ++e) edgeScalar(a, e);
+  };
+
+  CCSUB_TARGET_AVX2 static void evenAVX2(const Args& a, int begin, int end) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d w = _mm256_set1_pd(1.0 / 16.0);
+    const __m128i four = _mm_set1_epi32(4);
+    int v = begin;
+    for (; v + 4 <= end; v += 4) {
+      // 4 頂点とも内部の価数 4 のときだけまとめて処理する
+      const __m128i o0 = _mm_loadu_si128((const __m128i*)(a.vout_offset + v));
+      const __m128i o1 = _mm_loadu_si128((const __m128i*)(a.vout_offset + v + 1));
+      int bnd;
+      std::memcpy(&bnd, a.is_boundary + v, sizeof(int));
+      if ((bnd != 0) ||
+          (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_sub_epi32(o1, o0), four)) != 0xffff)) {
+        for (int i = 0; i < 4; ++i) evenScalar(a, v + i);
+        continue;
+      }
+      // 4 頂点の角の値は vout_offset[v] の位置から頂点ごとに 4 個ずつ並んでいる
+      const double* c = a.corner + 4 * a.vout_offset[v];
+      __m256d r[4], sum[3];
+      for (int i = 0; i < 4; ++i, c += 16)
+        r[i] = _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(c), _mm256_loadu_pd(c + 4)),
+                             _mm256_add_pd(_mm256_loadu_pd(c + 8), _mm256_loadu_pd(c + 12)));
+      toSoA(r, sum);
+      for (int d = 0; d < 3; ++d) {
+        const __m256d p = _mm256_add_pd(_mm256_mul_pd(half, _mm256_loadu_pd(a.x[d] + v)),
+                                        _mm256_mul_pd(w, sum[d]));
+        _mm256_storeu_pd(a.s[d] + v, p);
+      }
+    }
+    for (; v < end; ++v) evenScalar(a, v);
+  };
+
+  //
+  // SSE2: 2 点ずつ (gather がないので番号は 1 つずつ読む)
+  //
+  static void faceSSE2(const Args& a, int begin, int end) {
+    const __m128d w = _mm_set1_pd(CC_MASK_FACE_VV);
+    const __m128d zero = _mm_setzero_pd();
+    const int fb = a.nv + a.ne;
+    int f = begin;
+    for (; f + 2 <= end; f += 2) {
+      const int* c = a.fv + 4 * f;
+      __m128d xk[3][4], p[3];
+      for (int d = 0; d < 3; ++d) {
+        const double* x = a.x[d];
+        for (int k = 0; k < 4; ++k) xk[d][k] = _mm_set_pd(x[c[4 + k]], x[c[k]]);
+        p[d] = _mm_mul_pd(w, _mm_add_pd(_mm_add_pd(xk[d][0], xk[d][1]),
+                                        _mm_add_pd(xk[d][2], xk[d][3])));
+        _mm_storeu_pd(a.s[d] + fb + f, p[d]);
+      }
+      // 角 k の値を面ごとの (x, y, z, 0) に並べ替えて書き込む
+      for (int k = 0; k < 4; ++k) {
+        const __m128d qx = _mm_add_pd(xk[0][k], p[0]);
+        const __m128d qy = _mm_add_pd(xk[1][k], p[1]);
+        const __m128d qz = _mm_add_pd(xk[2][k], p[2]);
+        double* q0 = a.corner + 4 * a.vout_index[next(4 * f + k)];
+        double* q1 = a.corner + 4 * a.vout_index[next(4 * f + 4 + k)];
+        _mm_storeu_pd(q0, _mm_unpacklo_pd(qx, qy));
+        _mm_storeu_pd(q0 + 2, _mm_unpacklo_pd(qz, zero));
+        _mm_storeu_pd(q1, _mm_unpackhi_pd(qx, qy));
+        _mm_storeu_pd(q1 + 2, _mm_unpackhi_pd(qz, zero));
+      }
+    }
+    for (; f < end; ++f) faceScalar(a, f);
+  };
+
+  // 2 点分の (x, y) r[i] と (z, *) u[i] を座標ごとの列 p[d] に並べ替える
+  static void toSoA(const __m128d r[2], const __m128d u[2], __m128d p[3]) {
+    p[0] = _mm_unpacklo_pd(r[0], r[1]);
+    p[1] = _mm_unpackhi_pd(r[0], r[1]);
+    p[2] = _mm_unpacklo_pd(u[0], u[1]);
+  };
+
+  static void edgeSSE2(const Args& a, int begin, int end) {
+    const __m128d quarter = _mm_set1_pd(0.25);
+    int e = begin;
+    for (; e + 2 <= end; e += 2) {
+      const int h[2] = {a.edge_he[e], a.edge_he[e + 1]};
+      const int m[2] = {a.mate[h[0]], a.mate[h[1]]};
+      if ((m[0] < 0) || (m[1] < 0)) {
+        edgeScalar(a, e);
+        edgeScalar(a, e + 1);
+        continue;
+      }
+      __m128d r[2], u[2], p[3];
+      for (int i = 0; i < 2; ++i) {
+        const double* c0 = a.corner + 4 * a.vout_index[next(h[i])];
+        const double* c1 = a.corner + 4 * a.vout_index[next(m[i])];
+        r[i] = _mm_add_pd(_mm_loadu_pd(c0), _mm_loadu_pd(c1));
+        u[i] = _mm_add_pd(_mm_loadu_pd(c0 + 2), _mm_loadu_pd(c1 + 2));
+      }
+      toSoA(r, u, p);
+      for (int d = 0; d < 3; ++d) _mm_storeu_pd(a.s[d] + a.nv + e, _mm_mul_pd(quarter, p[d]));
+    }
+    for (; e < end; ++e) edgeScalar(a, e);
+  };
+
+  static void evenSSE2(const Args& a, int begin, int end) {
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d w = _mm_set1_pd(1.0 / 16.0);
+    int v = begin;
+    for (; v + 2 <= end; v += 2) {
+      const int* o = a.vout_offset + v;
+      if (a.is_boundary[v] || a.is_boundary[v + 1] || (o[1] - o[0] != 4) ||
+          (o[2] - o[1] != 4)) {
+        evenScalar(a, v);
+        evenScalar(a, v + 1);
+        continue;
+      }
+      const double* c = a.corner + 4 * o[0];
+      __m128d r[2], u[2], sum[3];
+      for (int i = 0; i < 2; ++i, c += 16) {
+        r[i] = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(c), _mm_loadu_pd(c + 4)),
+                          _mm_add_pd(_mm_loadu_pd(c + 8), _mm_loadu_pd(c + 12)));
+        u[i] = _mm_add_pd(_mm_add_pd(_mm_loadu_pd(c + 2), _mm_loadu_pd(c + 6)),
+                          _mm_add_pd(_mm_loadu_pd(c + 10), _mm_loadu_pd(c + 14)));
+      }
+      toSoA(r, u, sum);
+      for (int d = 0; d < 3; ++d) {
+        const __m128d p = _mm_add_pd(_mm_mul_pd(half, _mm_loadu_pd(a.x[d] + v)),
+                                     _mm_mul_pd(w, sum[d]));
+        _mm_storeu_pd(a.s[d] + v, p);
+      }
+    }
+    for (; v < end; ++v) evenScalar(a, v);
+  };
+#else
+  static void faceAVX2(const Args& a, int b, int e) { faceSSE2(a, b, e); };
+  static void edgeAVX2(const Args& a, int b, int e) { edgeSSE2(a, b, e); };
+  static void evenAVX2(const Args& a, int b, int e) { evenSSE2(a, b, e); };
+  static void faceSSE2(const Args& a, int b, int e) { for (; b < e; ++b) faceScalar(a, b); };
+  static void edgeSSE2(const Args& a, int b, int e) { for (; b < e; ++b) edgeScalar(a, b); };
+  static void evenSSE2(const Args& a, int b, int e) { for (; b < e; ++b) evenScalar(a, b); };
+#endif
+};
+
+#endif  // _CCSUBSIMD_HXX
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////
+//
+// LRU cache of GLMeshL buffers for switching between meshes.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _GLMESHLCACHE_HXX
+#define _GLMESHLCACHE_HXX 1
+
+#include <cstddef>
+#include <list>
+#include <memory>
+
+#include "MeshL.hxx"
+
+#include "GLMeshL.hxx"
+
+// GLMeshLCache は，MeshL ごとに VAO/VBO を作った GLMeshL を保持し，
+// 同じ MeshL をもう一度表示するときは作り直さずにそのまま返す．
+//
+// 保持するバッファの合計 (見積もり) が budget を超えたら，最も長く
+// 使われていないものから deleteVAOVBO() で解放する．直前に get() した
+// ものは解放しない．MeshL は shared_ptr で保持するので，キーにしている
+// アドレスが別の MeshL に再利用されることはない．
+//
+// 表示モード (smooth shading, wireframe) はすべての GLMeshL に同じものを設定する．
+class GLMeshLCache {
+ public:
+  GLMeshLCache()
+      : budget_(512 * 1024 * 1024), used_(0), smooth_(-1), wireframe_(-1){};
+  ~GLMeshLCache() { clear(); };
+
+  // GPU バッファの上限 (バイト)
+  void setMemoryBudget(size_t bytes) {
+    budget_ = bytes;
+    evict();
+  };
+  size_t memoryBudget() const { return budget_; };
+  size_t memoryUsed() const { return used_; };
+  int size() const { return (int)entries_.size(); };
+
+  // mesh を描画する GLMeshL を返す．なければバッファを作る．
+  GLMeshL& get(std::shared_ptr<MeshL> mesh) {
+    for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+      if (it->mesh != mesh) continue;
+      entries_.splice(entries_.begin(), entries_, it);
+      return *(entries_.front().gl);
+    }
+
+    Entry e;
+    e.mesh = mesh;
+    e.gl.reset(new GLMeshL);
+    if (smooth_ >= 0) e.gl->setIsSmoothShading(smooth_ != 0);
+    if (wireframe_ >= 0) e.gl->setIsDrawWireframe(wireframe_ != 0);
+    e.gl->setMesh(mesh);
+    e.bytes = estimateBytes(*mesh);
+    used_ += e.bytes;
+    entries_.push_front(std::move(e));
+    evict();
+    return *(entries_.front().gl);
+  };
+
+  // 表示モードは一度設定されるまで GLMeshL の既定値のままにする
+  void setIsSmoothShading(bool f) {
+    smooth_ = f ? 1 : 0;
+    for (auto& e : entries_) e.gl->setIsSmoothShading(f);
+  };
+  void setIsDrawWireframe(bool f) {
+    wireframe_ = f ? 1 : 0;
+    for (auto& e : entries_) e.gl->setIsDrawWireframe(f);
+  };
+
+  // すべてのバッファを解放する (GL コンテキストがあるうちに呼ぶこと)
+  void clear() {
+    for (auto& e : entries_) e.gl->deleteVAOVBO();
+    entries_.clear();
+    used_ = 0;
+  };
+
+  // GLMeshL のバッファの大きさの見積もり
+  // 面を三角形に分割した頂点 (位置 + 法線, smooth/flat の 2 組) と
+  // ワイヤーフレームの線分 (各エッジ 1 本)
+  static size_t estimateBytes(MeshL& mesh) {
+    size_t tris = 0, halfedges = 0;
+    for (auto& fc : mesh.faces()) {
+      const size_t n = fc->size();
+      if (n >= 3) tris += n - 2;
+      halfedges += n;
+    }
+    const size_t attrib = 6 * sizeof(float);
+    return 2 * (3 * tris * attrib) + halfedges * 3 * sizeof(float);
+  };
+
+ private:
+  struct Entry {
+    std::shared_ptr<MeshL> mesh;
+    std::unique_ptr<GLMeshL> gl;
+    size_t bytes;
+  };
+
+  void evict() {
+    while ((used_ > budget_) && (entries_.size() > 1)) {
+      Entry& e = entries_.back();
+      e.gl->deleteVAOVBO();
+      used_ -= e.bytes;
+      entries_.pop_back();
+    }
+  };
+
+  std::list<Entry> entries_;  // 先頭が最近使ったもの
+  size_t budget_;
+  size_t used_;
+  int smooth_;     // -1: 未設定
+  int wireframe_;  // -1: 未設定
+};
+
+#endif  // _GLMESHLCACHE_HXX
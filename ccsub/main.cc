@@ -6,12 +6,14 @@
 //
 ////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <thread>
 
 #include "envDep.h"
 #include "mydef.h"
@@ -21,18 +23,24 @@
 #include <GLFW/glfw3.h>
 
 #include "CCSubL.hxx"
+#include "CCSubLevels.hxx"
 #include "MeshL.hxx"
 #include "SMFLIO.hxx"
 
-std::vector<std::shared_ptr<MeshL> > mesh;
+// 細分割レベルごとのメッシュ (次のレベルはワーカースレッドで計算する)
+CCSubLevels levels;
 int mno = 0;
+int mno_requested = -1;  // 計算待ちで表示を切り替えるレベル
 SMFLIO smflio;
 
 #include "GLMeshL.hxx"
+#include "GLMeshLCache.hxx"
 #include "GLPanel.hxx"
 
 GLPanel pane;
-GLMeshL glmeshl;
+// レベルごとの GLMeshL (一度作ったバッファは予算内で再利用する)
+GLMeshLCache glcache;
+GLMeshL* glmeshl = nullptr;
 
 ////////////////////////////////////////////////////////////////////////////////////
 
@@ -79,22 +87,22 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 
   // 1 (smooth shading)
   else if ((key == GLFW_KEY_1) && (action == GLFW_PRESS)) {
-    glmeshl.setIsSmoothShading(true);
-    glmeshl.setIsDrawWireframe(false);
+    glcache.setIsSmoothShading(true);
+    glcache.setIsDrawWireframe(false);
     return;
   }
 
   // 2 (flat shading)
   else if ((key == GLFW_KEY_2) && (action == GLFW_PRESS)) {
-    glmeshl.setIsSmoothShading(false);
-    glmeshl.setIsDrawWireframe(false);
+    glcache.setIsSmoothShading(false);
+    glcache.setIsDrawWireframe(false);
     return;
   }
 
   // 3 (flat + wireframe)
   else if ((key == GLFW_KEY_3) && (action == GLFW_PRESS)) {
-    glmeshl.setIsSmoothShading(false);
-    glmeshl.setIsDrawWireframe(true);
+    glcache.setIsSmoothShading(false);
+    glcache.setIsDrawWireframe(true);
     return;
   }
 
@@ -109,25 +117,24 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
   }
 
   // m
+  // 次のレベルがまだなければ計算を始め，できた時点で描画ループが切り替える
   else if ((key == GLFW_KEY_M) && (action == GLFW_PRESS)) {
-    mno++;
-    if (mno == mesh.size()) {
-      std::shared_ptr<MeshL> mesh1 = std::make_shared<MeshL>();
-      mesh.push_back( mesh1 );
-      CCSubL ccsub( *(mesh[mno-1]), *(mesh[mno]) );
-      ccsub.apply();
+    if (levels.request(mno + 1) == false) {
+      mno_requested = mno + 1;
+      return;
     }
-    glmeshl.setMesh( mesh[mno] );
-    //glmeshl.buildBuffers();
+    mno++;
+    mno_requested = -1;
+    glmeshl = &glcache.get(levels.level(mno));
     return;
   }
 
   // n
   else if ((key == GLFW_KEY_N) && (action == GLFW_PRESS)) {
+    mno_requested = -1;
     if (mno == 0) return;
     mno--;
-    glmeshl.setMesh( mesh[mno] );
-    //glmeshl.buildBuffers();
+    glmeshl = &glcache.get(levels.level(mno));
     return;
   }
 
@@ -197,15 +204,17 @@ static void windowsize_callback(GLFWwindow* window, int w, int h) {
 ////////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " in.obj" << std::endl;
+  // -f: 演習のコード (CCSubL::apply()) ではなく配列上の細分割を使う
+  const bool flat = (argc == 3) && (std::string(argv[1]) == "-f");
+  if ((argc != 2) && (flat == false)) {
+    std::cerr << "Usage: " << argv[0] << " [-f] in.obj" << std::endl;
     return EXIT_FAILURE;
   }
 
   // メッシュデータの読み込み
   std::shared_ptr<MeshL> mesh0 = std::make_shared<MeshL>();
   smflio.setMesh(*mesh0);
-  if (smflio.inputFromFile(argv[1]) == false) {
+  if (smflio.inputFromFile(argv[argc - 1]) == false) {
      return EXIT_FAILURE;
   }
   
@@ -213,7 +222,11 @@ int main(int argc, char** argv) {
   mesh0->createConnectivity(true);
   
   mesh0->calcSmoothVertexNormal();
-  mesh.push_back(mesh0);
+  levels.setBase(mesh0);
+  levels.setFlat(flat);
+  levels.setNumThreads(std::max(1, (int)std::thread::hardware_concurrency() - 1));
+  // 面数 4M までは表示中の次のレベルを先読みしておく
+  levels.setSpeculative(true, 4 * 1024 * 1024);
 
   // ここからウインドウの初期化処理
   glfwSetErrorCallback(error_callback);
@@ -267,20 +280,31 @@ int main(int argc, char** argv) {
   // ここまでウインドウの初期化処理
 
   // メッシュ表示用 に mesh をセット
-  glmeshl.setMesh(mesh[0]);
-//  glmeshl.buildBuffers();
+  glmeshl = &glcache.get(levels.level(0));
 
   c11fps.ResetFPS();
   
   // 描画ループ処理
   while (!glfwWindowShouldClose(window)) {
 
+    // 細分割の結果を待たずに確認し，要求されたレベルができていれば切り替える
+    if (levels.poll(mno) && (mno_requested >= 0) &&
+        (mno_requested < levels.size())) {
+      mno = mno_requested;
+      mno_requested = -1;
+      glmeshl = &glcache.get(levels.level(mno));
+    }
+    if ((mno_requested >= 0) && (levels.isBusy() == false)) {
+      // 細分割できなかった
+      mno_requested = -1;
+    }
+
     // 画面のクリア・初期化
     glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
     pane.clear(fbWidth, fbHeight);
-    pane.update(glmeshl.material());
+    pane.update(glmeshl->material());
 
-    glmeshl.draw(pane.shader());
+    glmeshl->draw(pane.shader());
 
     pane.finish();
 
@@ -293,12 +317,18 @@ int main(int argc, char** argv) {
     std::string buf = ss.str();
     
     std::string txt = "GLFW Window - " + buf;
+    if (levels.isBusy())
+      txt += " - subdividing level " + std::to_string(levels.pendingLevel());
     glfwSetWindowTitle( window, txt.c_str() );
     
     glfwSwapBuffers(window);
     glfwPollEvents();
   }
 
+  // 計算中の細分割を待ってから終了する
+  levels.wait();
+  glcache.clear();
+
   // ウインドウ終了処理
   glfwDestroyWindow(window);
   glfwTerminate();
@@ -0,0 +1,508 @@
+////////////////////////////////////////////////////////////////////
+//
+// Headless kD-Tree benchmark against a brute-force baseline (CSV / JSON).
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "KdTreeFlat.hxx"
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// 実行するパラメータ (-n, -d, -k, -r, -g, -c はコンマ区切りの組み合わせをすべて実行する)
+struct Options {
+  std::vector<long long> sizes;
+  std::vector<int> dims;
+  std::vector<int> ks;
+  std::vector<double> radii;
+  std::vector<std::string> dists;
+  std::vector<std::string> scalars;
+  int queries;
+  long long brute_max;  // これより点が多ければ全探索は行わない
+  unsigned seed;
+  int nthreads;
+  int repeat;
+  bool allknn;  // allKnn() を計測する
+  std::string format;
+  std::string output;
+};
+
+// 1 つの計測結果 (repeat 回のうち最短の時間)
+// - op: construct, nn, knn, radius, allknn, allknn_b1
+// - param: knn, allknn の k, radius の半径 (construct, nn は 0)
+// - brute_ms: 全探索の時間 (行わなければ負)．allknn は全点の knnSearchBatch() の時間
+// - results: 見つけた近傍点の数の合計
+// - errors: 全探索と結果が違ったクエリの数
+struct Record {
+  std::string dist;
+  int dim;
+  std::string scalar;
+  long long n;
+  std::string op;
+  double param;
+  double tree_ms;
+  double brute_ms;
+  long long results;
+  long long errors;
+};
+
+template <class F>
+static double bestTime(int repeat, F&& f) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < repeat; ++r) {
+    const auto t0 = std::chrono::steady_clock::now();
+    f();
+    const auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(t1 - t0).count());
+  }
+  return best;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// 点の分布 ([0, 1]^N の中)
+// - uniform: 一様分布
+// - gauss: 32 個の中心のまわりの正規分布 (標準偏差 0.01)
+// - line: 対角線 (0, ..., 0) - (1, ..., 1) の上 (分割軸が決まらない退化した分布)
+// - curve: 軸ごとに周波数の違う正弦波の曲線の上
+// - dup: n / 100 個の点の重複 (各点が平均 100 個)
+static bool isDistribution(const std::string& s) {
+  return (s == "uniform") || (s == "gauss") || (s == "line") || (s == "curve") || (s == "dup");
+}
+
+template <int N>
+static void generate(const std::string& dist, long long n, unsigned seed,
+                     std::vector<Eigen::Vector<double, N> >& points) {
+  typedef Eigen::Vector<double, N> Point;
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double> normal(0.0, 0.01);
+  const double pi = 3.14159265358979323846;
+  points.resize(n);
+
+  // gauss の中心と dup の点は分布ごとに決める (クエリも同じものを使う)
+  std::mt19937_64 base(0x5eedULL);
+  std::vector<Point> centers(dist == "dup" ? std::max(1LL, n / 100) : 32);
+  for (auto& c : centers)
+    for (int d = 0; d < N; ++d) c[d] = 0.1 + 0.8 * uniform(base);
+
+  for (long long i = 0; i < n; ++i) {
+    Point& p = points[i];
+    if (dist == "gauss") {
+      const Point& c = centers[rng() % centers.size()];
+      for (int d = 0; d < N; ++d) p[d] = c[d] + normal(rng);
+    } else if (dist == "line") {
+      p.setConstant(uniform(rng));
+    } else if (dist == "curve") {
+      const double t = uniform(rng);
+      p[0] = t;
+      for (int d = 1; d < N; ++d) p[d] = 0.5 + 0.4 * std::sin(2.0 * pi * (d + 1) * t + d);
+    } else if (dist == "dup") {
+      p = centers[rng() % centers.size()];
+    } else {
+      for (int d = 0; d < N; ++d) p[d] = uniform(rng);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// 全探索 (距離は KdTreeFlat の葉の中と同じく軸の順に足す)
+template <int N>
+class Brute {
+ public:
+  typedef Eigen::Vector<double, N> Point;
+
+  Brute(const std::vector<Point>& points) : points_(points){};
+
+  double distance2(const Point& a, const Point& b) const {
+    double d2 = 0.0;
+    for (int d = 0; d < N; ++d) {
+      const double t = a[d] - b[d];
+      d2 += t * t;
+    }
+    return d2;
+  };
+
+  double nnSearch(const Point& q) const {
+    double best = std::numeric_limits<double>::max();
+    for (const Point& p : points_) best = std::min(best, distance2(p, q));
+    return best;
+  };
+
+  // k 個の近傍点の2乗距離を近い順に dist2 に入れる
+  void knnSearch(const Point& q, int k, std::vector<double>& dist2) const {
+    dist2.clear();
+    for (const Point& p : points_) {
+      const double d2 = distance2(p, q);
+      if ((int)dist2.size() < k) {
+        dist2.push_back(d2);
+        std::push_heap(dist2.begin(), dist2.end());
+      } else if (d2 < dist2.front()) {
+        std::pop_heap(dist2.begin(), dist2.end());
+        dist2.back() = d2;
+        std::push_heap(dist2.begin(), dist2.end());
+      }
+    }
+    std::sort_heap(dist2.begin(), dist2.end());
+  };
+
+  int radiusSearch(const Point& q, double r) const {
+    const double r2 = r * r;
+    int count = 0;
+    for (const Point& p : points_) count += (distance2(p, q) <= r2) ? 1 : 0;
+    return count;
+  };
+
+ private:
+  const std::vector<Point>& points_;
+};
+
+// 2乗距離が (丸めの違いを除いて) 等しいか
+static bool sameDistance(double a, double b) {
+  return std::abs(a - b) <= 1e-12 * std::max(1.0, std::max(a, b));
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// すべての点の K近傍点: allKnn() と全点をクエリにした knnSearchBatch() (k + 1 個から
+// 点自身を除く) を比べる．errors は knnSearchBatch() と距離が違った点の数
+template <int N, int B, class T>
+static void benchmarkAllKnn(const Options& opt, const std::vector<Eigen::Vector<double, N> >& points,
+                            int k, Record& rec, std::vector<Record>& records) {
+  KdTreeFlat<N, B, T> tree;
+  tree.setNumThreads(opt.nthreads);
+  tree.construct(points);
+  const int n = (int)points.size();
+  KdBatchResult all, batch;
+  rec.param = k;
+  rec.tree_ms = bestTime(opt.repeat, [&]() { tree.allKnn(k, all); });
+  rec.brute_ms = bestTime(opt.repeat, [&]() { tree.knnSearchBatch(points, k + 1, batch); });
+  rec.results = (long long)all.indices.size();
+  rec.errors = 0;
+  for (int i = 0; i < n; ++i) {
+    bool ok = (all.count(i) + 1 == batch.count(i));
+    for (int j = 0; ok && (j < all.count(i)); ++j)
+      ok = sameDistance(all.dist2[all.offsets[i] + j], batch.dist2[batch.offsets[i] + j + 1]);
+    if (ok == false) ++rec.errors;
+  }
+  records.push_back(rec);
+}
+
+template <int N, class T>
+static void benchmark(const Options& opt, const std::string& dist, const std::string& scalar,
+                      long long n, std::vector<Record>& records) {
+  typedef Eigen::Vector<double, N> Point;
+  std::vector<Point> points, queries;
+  generate<N>(dist, n, opt.seed, points);
+  generate<N>(dist, opt.queries, opt.seed + 1, queries);
+  const int nq = (int)queries.size();
+  const bool brute = (n <= opt.brute_max);
+  Brute<N> bf(points);
+
+  Record rec;
+  rec.dist = dist;
+  rec.dim = N;
+  rec.scalar = scalar;
+  rec.n = n;
+
+  KdTreeFlat<N, 16, T> tree;
+  tree.setNumThreads(opt.nthreads);
+  rec.op = "construct";
+  rec.param = 0.0;
+  rec.tree_ms = bestTime(opt.repeat, [&]() { tree.construct(points); });
+  rec.brute_ms = -1.0;
+  rec.results = 0;
+  rec.errors = 0;
+  records.push_back(rec);
+  std::cerr << dist << " N=" << N << " " << scalar << " n=" << n << ": construct "
+            << rec.tree_ms << " ms" << std::endl;
+
+  // 最近傍点
+  {
+    std::vector<int> index(nq);
+    std::vector<double> exact(nq);
+    rec.op = "nn";
+    rec.tree_ms = bestTime(opt.repeat, [&]() {
+      for (int i = 0; i < nq; ++i) index[i] = tree.nnSearch(queries[i]);
+    });
+    rec.brute_ms = brute ? bestTime(opt.repeat, [&]() {
+      for (int i = 0; i < nq; ++i) exact[i] = bf.nnSearch(queries[i]);
+    }) : -1.0;
+    rec.results = nq;
+    rec.errors = 0;
+    if (brute)
+      for (int i = 0; i < nq; ++i)
+        if ((index[i] < 0) || !sameDistance(bf.distance2(points[index[i]], queries[i]), exact[i]))
+          ++rec.errors;
+    records.push_back(rec);
+  }
+
+  // K近傍点 (作業領域を使い回す)
+  for (int k : opt.ks) {
+    KdQueryContext ctx;
+    std::vector<std::vector<double> > found(nq), exact(brute ? nq : 0);
+    rec.op = "knn";
+    rec.param = k;
+    rec.tree_ms = bestTime(opt.repeat, [&]() {
+      for (int i = 0; i < nq; ++i) {
+        tree.knnSearch(queries[i], k, ctx);
+        found[i].assign(ctx.dist2.begin(), ctx.dist2.end());
+      }
+    });
+    rec.brute_ms = brute ? bestTime(opt.repeat, [&]() {
+      for (int i = 0; i < nq; ++i) bf.knnSearch(queries[i], k, exact[i]);
+    }) : -1.0;
+    rec.results = 0;
+    rec.errors = 0;
+    for (int i = 0; i < nq; ++i) {
+      rec.results += (long long)found[i].size();
+      if (brute == false) continue;
+      bool ok = (found[i].size() == exact[i].size());
+      for (int j = 0; ok && (j < (int)found[i].size()); ++j)
+        ok = sameDistance(found[i][j], exact[i][j]);
+      if (ok == false) ++rec.errors;
+    }
+    records.push_back(rec);
+  }
+
+  // 半径探索
+  for (double r : opt.radii) {
+    KdQueryContext ctx;
+    std::vector<int> found(nq), exact(nq);
+    rec.op = "radius";
+    rec.param = r;
+    rec.tree_ms = bestTime(opt.repeat, [&]() {
+      for (int i = 0; i < nq; ++i) found[i] = tree.radiusSearch(queries[i], r, ctx);
+    });
+    rec.brute_ms = brute ? bestTime(opt.repeat, [&]() {
+      for (int i = 0; i < nq; ++i) exact[i] = bf.radiusSearch(queries[i], r);
+    }) : -1.0;
+    rec.results = 0;
+    rec.errors = 0;
+    for (int i = 0; i < nq; ++i) {
+      rec.results += found[i];
+      if (brute && (found[i] != exact[i])) ++rec.errors;
+    }
+    records.push_back(rec);
+  }
+
+  // すべての点の K近傍点 (B = 1 の木は葉の数を 2 のべきに揃えるための空の葉が多い)
+  if (opt.allknn)
+    for (int k : opt.ks) {
+      rec.op = "allknn";
+      benchmarkAllKnn<N, 16, T>(opt, points, k, rec, records);
+      rec.op = "allknn_b1";
+      benchmarkAllKnn<N, 1, T>(opt, points, k, rec, records);
+    }
+}
+
+template <int N>
+static void benchmarkScalar(const Options& opt, const std::string& dist,
+                            const std::string& scalar, long long n,
+                            std::vector<Record>& records) {
+  if (scalar == "float")
+    benchmark<N, float>(opt, dist, scalar, n, records);
+  else if (scalar == "q16")
+    benchmark<N, KdQuant16>(opt, dist, scalar, n, records);
+  else
+    benchmark<N, double>(opt, dist, scalar, n, records);
+}
+
+// 次元はテンプレートの引数なので，2 から 8 までをここで選ぶ
+static void benchmarkDim(const Options& opt, int dim, const std::string& dist,
+                         const std::string& scalar, long long n,
+                         std::vector<Record>& records) {
+  switch (dim) {
+    case 2: benchmarkScalar<2>(opt, dist, scalar, n, records); break;
+    case 3: benchmarkScalar<3>(opt, dist, scalar, n, records); break;
+    case 4: benchmarkScalar<4>(opt, dist, scalar, n, records); break;
+    case 5: benchmarkScalar<5>(opt, dist, scalar, n, records); break;
+    case 6: benchmarkScalar<6>(opt, dist, scalar, n, records); break;
+    case 7: benchmarkScalar<7>(opt, dist, scalar, n, records); break;
+    case 8: benchmarkScalar<8>(opt, dist, scalar, n, records); break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+static std::string jsonString(const std::string& s) {
+  std::string r = "\"";
+  for (char c : s) {
+    if ((c == '"') || (c == '\\')) r += '\\';
+    r += c;
+  }
+  return r + "\"";
+}
+
+static std::string outputCSV(const std::vector<Record>& records) {
+  std::ostringstream os;
+  os << "distribution,dim,scalar,n,op,param,tree_ms,brute_ms,speedup,results,errors\n";
+  for (const Record& r : records) {
+    os << r.dist << "," << r.dim << "," << r.scalar << "," << r.n << "," << r.op << ","
+       << r.param << "," << r.tree_ms << ",";
+    if (r.brute_ms >= 0.0) os << r.brute_ms << "," << r.brute_ms / r.tree_ms;
+    else os << ",";
+    os << "," << r.results << "," << r.errors << "\n";
+  }
+  return os.str();
+}
+
+static std::string outputJSON(const Options& opt, const std::vector<Record>& records) {
+  std::ostringstream js;
+  js << "{\n";
+  js << "  \"seed\": " << opt.seed << ",\n";
+  js << "  \"queries\": " << opt.queries << ",\n";
+  js << "  \"threads\": " << opt.nthreads << ",\n";
+  js << "  \"repeat\": " << opt.repeat << ",\n";
+  js << "  \"results\": [\n";
+  for (int i = 0; i < (int)records.size(); ++i) {
+    const Record& r = records[i];
+    js << "    {\"distribution\": " << jsonString(r.dist) << ", \"dim\": " << r.dim
+       << ", \"scalar\": " << jsonString(r.scalar) << ", \"n\": " << r.n
+       << ", \"op\": " << jsonString(r.op) << ", \"param\": " << r.param
+       << ", \"tree_ms\": " << r.tree_ms << ", \"brute_ms\": ";
+    if (r.brute_ms >= 0.0)
+      js << r.brute_ms << ", \"speedup\": " << r.brute_ms / r.tree_ms;
+    else
+      js << "null, \"speedup\": null";
+    js << ", \"results\": " << r.results << ", \"errors\": " << r.errors << "}"
+       << ((i + 1 < (int)records.size()) ? ",\n" : "\n");
+  }
+  js << "  ]\n";
+  js << "}\n";
+  return js.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// コンマ区切りのリスト ("1e3,1e4" のような指数の表記も使える)
+template <class V>
+static bool parseList(const char* s, std::vector<V>& values) {
+  values.clear();
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    char* end = nullptr;
+    const double v = strtod(item.c_str(), &end);
+    if (item.empty() || (*end != '\0')) return false;
+    values.push_back((V)v);
+  }
+  return !values.empty();
+}
+
+static void parseNames(const char* s, std::vector<std::string>& names) {
+  names.clear();
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ',')) names.push_back(item);
+}
+
+static void usage(const char* prog) {
+  std::cerr << "Usage: " << prog
+            << " [-n sizes] [-d dims] [-k ks] [-r radii] [-g distributions]"
+               " [-c double,float,q16] [-q queries] [-b brute_max] [-s seed] [-t threads]"
+               " [-R repeat] [-a] [-f csv|json] [-o out]"
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  Options opt;
+  opt.sizes = {1000, 10000, 100000, 1000000};
+  opt.dims = {2, 3};
+  opt.ks = {1, 10};
+  opt.radii = {0.01};
+  opt.dists = {"uniform", "gauss", "line", "curve", "dup"};
+  opt.scalars = {"double"};
+  opt.queries = 1000;
+  opt.brute_max = 1000000;
+  opt.seed = 1;
+  opt.nthreads = 1;
+  opt.repeat = 1;
+  opt.allknn = false;
+  opt.format = "csv";
+
+  bool ok = true;
+  for (int i = 1; ok && (i < argc); ++i) {
+    const bool has_arg = (i + 1 < argc);
+    if (!strcmp(argv[i], "-n") && has_arg) {
+      ok = parseList(argv[++i], opt.sizes);
+    } else if (!strcmp(argv[i], "-d") && has_arg) {
+      ok = parseList(argv[++i], opt.dims);
+    } else if (!strcmp(argv[i], "-k") && has_arg) {
+      ok = parseList(argv[++i], opt.ks);
+    } else if (!strcmp(argv[i], "-r") && has_arg) {
+      ok = parseList(argv[++i], opt.radii);
+    } else if (!strcmp(argv[i], "-g") && has_arg) {
+      parseNames(argv[++i], opt.dists);
+    } else if (!strcmp(argv[i], "-c") && has_arg) {
+      parseNames(argv[++i], opt.scalars);
+    } else if (!strcmp(argv[i], "-q") && has_arg) {
+      opt.queries = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-b") && has_arg) {
+      opt.brute_max = (long long)atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-s") && has_arg) {
+      opt.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+    } else if (!strcmp(argv[i], "-t") && has_arg) {
+      opt.nthreads = std::max(1, atoi(argv[++i]));
+    } else if (!strcmp(argv[i], "-R") && has_arg) {
+      opt.repeat = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-a")) {
+      opt.allknn = true;
+    } else if (!strcmp(argv[i], "-f") && has_arg) {
+      opt.format = argv[++i];
+    } else if (!strcmp(argv[i], "-o") && has_arg) {
+      opt.output = argv[++i];
+    } else {
+      ok = false;
+    }
+  }
+  for (long long n : opt.sizes) ok = ok && (n >= 1) && (n <= std::numeric_limits<int>::max());
+  for (int d : opt.dims) ok = ok && (d >= 2) && (d <= 8);
+  for (int k : opt.ks) ok = ok && (k >= 1);
+  for (double r : opt.radii) ok = ok && (r >= 0.0);
+  for (auto& g : opt.dists) ok = ok && isDistribution(g);
+  for (auto& c : opt.scalars) ok = ok && ((c == "double") || (c == "float") || (c == "q16"));
+  if ((ok == false) || (opt.queries < 1) || (opt.repeat < 1) ||
+      ((opt.format != "csv") && (opt.format != "json"))) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Record> records;
+  for (auto& dist : opt.dists)
+    for (int dim : opt.dims)
+      for (auto& scalar : opt.scalars)
+        for (long long n : opt.sizes) benchmarkDim(opt, dim, dist, scalar, n, records);
+
+  const std::string out = (opt.format == "json") ? outputJSON(opt, records) : outputCSV(records);
+  if (opt.output.empty()) {
+    std::cout << out;
+  } else {
+    FILE* fp = fopen(opt.output.c_str(), "w");
+    if (fp == nullptr) {
+      std::cerr << "Error: cannot open " << opt.output << ". " << std::endl;
+      return EXIT_FAILURE;
+    }
+    fputs(out.c_str(), fp);
+    fclose(fp);
+  }
+  return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////
+//
+// Dynamic kD-Tree: a logarithmic forest of static KdTreeFlat trees.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef __KDTREEDYNAMIC_HXX__
+#define __KDTREEDYNAMIC_HXX__ 1
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "KdTreeFlat.hxx"
+
+//
+// 点の追加と削除ができる N次元 kD-Tree クラス
+// - 静的な KdTreeFlat<N, B, T> の森で点を持つ (Bentley-Saxe の logarithmic method)．
+//   レベル l の木は最大 BufferSize * 2^l 個の点を持ち，各レベルの木は高々 1 本である
+// - insert() した点は，まず BufferSize 個までのバッファに入れる (バッファは全探索する)．
+//   バッファがいっぱいになったら，バッファと空いていない下のレベルの木の点をまとめて
+//   最初の空いたレベルに木を作り直す．1 つの点が作り直しに加わるのは O(log n) 回なので，
+//   追加のならしの計算量は O(log^2 n) である
+// - erase() は点に削除の印を付けるだけで，木の点の半分以上が削除されたらその木を作り直す
+// - 点の番号は insert() が返す番号で，削除しても変わらない (番号は再利用しない)．
+//   construct() で作った点の番号は points の順 (0, 1, ...) である
+// - nnSearch / knnSearch / radiusSearch は KdTree<N> と同じで，点の番号を返す．
+//   K近傍点探索は 1 つのヒープをすべての木で共有するので，先に調べた木で見つけた点より
+//   遠い部分木は次の木でも調べない
+//
+template<int N, int B = 16, class T = double>
+class KdTreeDynamic {
+
+public:
+
+  typedef Eigen::Vector<double,N> Point;
+  typedef KdTreeFlat<N,B,T> Tree;
+  enum { BufferSize = 64 };
+
+  KdTreeDynamic() : nthreads_(1), alive_size_(0) {};
+  ~KdTreeDynamic() {};
+
+  // 木を作り直すときのスレッド数
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
+  // 削除されていない点の数
+  int size() const { return alive_size_; };
+  // これまでに付けた点の番号の数 (削除された点も含む)
+  int ids_size() const { return (int)points_.size(); };
+  const Point& point(int id) const { return points_[id]; };
+  bool alive(int id) const { return (id >= 0) && (id < ids_size()) && alive_[id]; };
+  // 空でない木の数
+  int trees_size() const {
+    int n = 0;
+    for (auto& l : levels_) n += l.ids.empty() ? 0 : 1;
+    return n;
+  };
+
+  // 点列から作り直す (点の番号は 0 ... points.size() - 1)
+  void construct(const std::vector<Point>& points) {
+    clear();
+    points_ = points;
+    alive_.assign(points_.size(), 1);
+    level_.assign(points_.size(), -1);
+    alive_size_ = (int)points_.size();
+    std::vector<int> ids(points_.size());
+    for (int i = 0; i < (int)ids.size(); ++i) ids[i] = i;
+    if ((int)ids.size() < BufferSize) {
+      buffer_ = ids;
+      return;
+    }
+    int l = 0;
+    while (((long long)BufferSize << l) < (long long)ids.size()) ++l;
+    build(l, ids);
+  };
+
+  void clear() {
+    points_.clear();
+    alive_.clear();
+    level_.clear();
+    buffer_.clear();
+    levels_.clear();
+    alive_size_ = 0;
+  };
+
+  // 点を追加して番号を返す
+  int insert(const Point& p) {
+    const int id = (int)points_.size();
+    points_.push_back(p);
+    alive_.push_back(1);
+    level_.push_back(-1);
+    buffer_.push_back(id);
+    ++alive_size_;
+    if ((int)buffer_.size() >= BufferSize) flush();
+    return id;
+  };
+
+  // 点を削除する (番号が正しくないか，既に削除されていれば false)
+  bool erase(int id) {
+    if (alive(id) == false) return false;
+    alive_[id] = 0;
+    --alive_size_;
+    const int l = level_[id];
+    if (l < 0) {
+      buffer_.erase(std::find(buffer_.begin(), buffer_.end(), id));
+      return true;
+    }
+    // 木の点の半分以上が削除されたら，残った点で同じレベルに作り直す
+    Level& lv = levels_[l];
+    if (2 * (++lv.dead) >= (int)lv.ids.size()) {
+      std::vector<int> ids;
+      ids.reserve(lv.ids.size() - lv.dead);
+      for (int i : lv.ids)
+        if (alive_[i]) ids.push_back(i);
+      build(l, ids);
+    }
+    return true;
+  };
+
+  // 最近傍点の探索: 最近傍点の点の番号を返す (点がなければ -1)
+  // q: クエリ点
+  // min_dis: 最短距離
+  int nnSearch(const Point& query, double* min_dis = nullptr) const {
+    KdQueryContext ctx;
+    knnSearch(query, 1, ctx);
+    if (min_dis) *min_dis = ctx.indices.empty() ? std::numeric_limits<double>::max()
+                                                : std::sqrt(ctx.dist2[0]);
+    return ctx.indices.empty() ? -1 : ctx.indices[0];
+  };
+
+  // K近傍点の探索: k個の近傍点の番号列を距離の近い順に返す
+  // q: クエリ点
+  // k: 近傍点の数
+  std::vector<int> knnSearch(const Point& query, int k) const {
+    KdQueryContext ctx;
+    knnSearch(query, k, ctx);
+    return std::move(ctx.indices);
+  };
+
+  // K近傍点の探索 (作業領域 ctx を使い回す): 近傍点の番号を距離の近い順に
+  // ctx.indices, ctx.dist2 に入れ，その数を返す
+  int knnSearch(const Point& query, int k, KdQueryContext& ctx) const {
+    ctx.heap.clear();
+    if ((k > 0) && (alive_size_ > 0)) knnHeap(query, k, ctx);
+    std::sort_heap(ctx.heap.begin(), ctx.heap.end());
+    const int n = (int)ctx.heap.size();
+    ctx.indices.resize(n);
+    ctx.dist2.resize(n);
+    for (int i = 0; i < n; ++i) {
+      ctx.indices[i] = ctx.heap[i].second;
+      ctx.dist2[i] = ctx.heap[i].first;
+    }
+    return n;
+  };
+
+  // 半径探索: 半径r内の近傍点の番号列を返す (順番は不定)
+  // q: クエリ点
+  // r: 半径
+  std::vector<int> radiusSearch(const Point& q, double r) const {
+    KdQueryContext ctx;
+    radiusSearch(q, r, ctx);
+    return std::move(ctx.indices);
+  };
+
+  // 半径探索 (作業領域 ctx を使い回す): 半径r内の近傍点の番号を ctx.indices, ctx.dist2 に
+  // 入れ，その数を返す (順番は不定)
+  int radiusSearch(const Point& q, double r, KdQueryContext& ctx) const {
+    ctx.indices.clear();
+    ctx.dist2.clear();
+    if (r < 0.0) return 0;
+    const double r2 = r * r;
+    for (int i : buffer_) {
+      const double d2 = (points_[i] - q).squaredNorm();
+      if (d2 <= r2) {
+        ctx.indices.push_back(i);
+        ctx.dist2.push_back(d2);
+      }
+    }
+    for (auto& l : levels_) {
+      if (l.ids.empty()) continue;
+      l.tree.radiusVisit(q, r, [&](int i, double d2) {
+        const int id = l.ids[i];
+        if (alive_[id]) {
+          ctx.indices.push_back(id);
+          ctx.dist2.push_back(d2);
+        }
+      });
+    }
+    return ctx.size();
+  };
+
+private:
+
+  // レベルの木と，木の点のインデックスから点の番号への対応
+  struct Level {
+    Tree tree;
+    std::vector<int> ids;
+    int dead = 0;  // 削除された点の数
+  };
+
+  // 木とバッファの点で ctx.heap を更新する
+  // (点の多い木から調べて，早く近い点を見つけて後の木の枝刈りを効かせる)
+  void knnHeap(const Point& q, int k, KdQueryContext& ctx) const {
+    KdHeap& heap = ctx.heap;
+    for (int l = (int)levels_.size() - 1; l >= 0; --l) {
+      const Level& lv = levels_[l];
+      if (lv.ids.empty()) continue;
+      lv.tree.knnMerge(q, k, ctx, [&](int i) {
+        const int id = lv.ids[i];
+        return alive_[id] ? id : -1;
+      });
+    }
+    for (int i : buffer_) {
+      const double d2 = (points_[i] - q).squaredNorm();
+      if ((int)heap.size() < k) {
+        heap.push_back(std::make_pair(d2, i));
+        std::push_heap(heap.begin(), heap.end());
+      } else if (d2 < heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = std::make_pair(d2, i);
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+  };
+
+  // バッファと下のレベルの木の点を，最初の空いたレベルの木にまとめる
+  void flush() {
+    std::vector<int> ids(buffer_);
+    buffer_.clear();
+    int l = 0;
+    for (; l < (int)levels_.size() && !levels_[l].ids.empty(); ++l) {
+      for (int i : levels_[l].ids)
+        if (alive_[i]) ids.push_back(i);
+      levels_[l].ids.clear();
+      levels_[l].tree.clear();
+    }
+    build(l, ids);
+  };
+
+  // レベル l の木を点 ids で作り直す
+  void build(int l, const std::vector<int>& ids) {
+    if (l >= (int)levels_.size()) levels_.resize(l + 1);
+    Level& lv = levels_[l];
+    lv.ids = ids;
+    lv.dead = 0;
+    std::vector<Point> pts(ids.size());
+    for (int i = 0; i < (int)ids.size(); ++i) {
+      pts[i] = points_[ids[i]];
+      level_[ids[i]] = l;
+    }
+    lv.tree.setNumThreads(nthreads_);
+    if (ids.empty())
+      lv.tree.clear();
+    else
+      lv.tree.construct(pts);
+  };
+
+  //
+  // メンバ変数
+  //
+
+  std::vector<Point> points_;    // 点 (番号順，削除された点も残す)
+  std::vector<uint8_t> alive_;   // 削除されていなければ 1
+  std::vector<int> level_;       // 点を持つ木のレベル (バッファなら -1)
+  std::vector<int> buffer_;      // バッファの点の番号
+  std::vector<Level> levels_;
+  int nthreads_;
+  int alive_size_;
+
+};
+
+#endif // __KDTREEDYNAMIC_HXX__
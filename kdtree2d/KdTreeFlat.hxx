@@ -0,0 +1,1435 @@
+////////////////////////////////////////////////////////////////////
+//
+// Pointerless kD-Tree with an implicit layout and bucketed leaves.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef __KDTREEFLAT_HXX__
+#define __KDTREEFLAT_HXX__ 1
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "myEigen.hxx"
+
+#include "MappedFile.hxx"
+#include "Morton.hxx"
+#include "ParallelFor.hxx"
+#include "TaskPool.hxx"
+
+//
+// バッチ探索の結果 (クエリごとの近傍点を 1 つの配列に並べる)
+// - クエリ i の近傍点は indices[offsets[i]] ... indices[offsets[i + 1] - 1]
+// - dist2 はそれぞれの点までの2乗距離
+//
+struct KdBatchResult {
+  std::vector<int> offsets;
+  std::vector<int> indices;
+  std::vector<double> dist2;
+
+  int queries_size() const { return offsets.empty() ? 0 : (int)offsets.size() - 1; };
+  int count(int i) const { return offsets[i + 1] - offsets[i]; };
+};
+
+//
+// (2乗距離, インデックス) の組の配列 (K近傍点探索の最大ヒープなどに使う)
+//
+typedef std::vector<std::pair<double,int> > KdHeap;
+
+//
+// 探索の作業領域と結果
+// - heap: K近傍点の (2乗距離, インデックス) の最大ヒープ (k 個まで)
+// - stack: 木をたどるときの (距離の下限, ノード) のスタック
+//   (best-bin-first の近似探索では最小ヒープとして使う)
+// - indices, dist2: 結果の点のインデックスと2乗距離
+// 同じ作業領域で探索を繰り返せば，配列の大きさが足りてからはメモリの確保はない
+//
+struct KdQueryContext {
+  KdHeap heap;
+  KdHeap stack;
+  std::vector<int> indices;
+  std::vector<double> dist2;
+
+  int size() const { return (int)indices.size(); };
+};
+
+//
+// 近似探索のパラメータ
+// - eps: 遠い側の部分木は，分割面までの距離の (1 + eps) 倍が今の k 番目の距離より
+//   近いときだけ探索する．見つかる i 番目の点の距離は真の i 番目の距離の (1 + eps) 倍以内になる
+// - max_leaves: 調べる葉の数の上限 (0 なら上限なし)．上限を指定すると，分割面までの距離が
+//   近い部分木から順に調べ (best-bin-first)，上限に達したら終わる．
+//   k 個見つかるまでは上限を超えて探索を続ける
+// eps = 0, max_leaves = 0 は厳密な探索と同じである
+//
+struct KdApprox {
+  double eps;
+  int max_leaves;
+
+  KdApprox(double e = 0.0, int m = 0) : eps(e), max_leaves(m) {};
+};
+
+//
+// 葉の座標の型 (KdTreeFlat の T)
+// - double, float: 座標をその型で持つ
+// - KdQuant16: 葉ごとのバウンディングボックスの中で 16 ビットの整数に量子化して持つ
+//   (座標は lo + scale * u で，lo, scale は葉ごと軸ごとの float)
+// Stored は葉の配列の要素の型，Real は葉の中の距離を計算する型である
+//
+struct KdQuant16 {};
+
+template<class T>
+struct KdScalar {
+  typedef T Stored;
+  typedef T Real;
+  enum { Quantized = 0 };
+};
+
+template<>
+struct KdScalar<KdQuant16> {
+  typedef uint16_t Stored;
+  typedef float Real;
+  enum { Quantized = 1 };
+};
+
+//
+// KdTreeFlat のバイナリファイル (save() / load())
+//   KdFlatFileHeader (先頭)
+//   Point   点 [n] (元の順，T が double で flags に KDFLAT_POINTS があるときだけ)
+//   int32   葉の先頭 [leaves + 1]
+//   double  分割値 [leaves - 1]
+//   uint8   分割軸 [leaves - 1]
+//   int32   点のインデックス [leaves][B]
+//   Stored  座標 [leaves][N][B] (Stored は KdScalar<T>::Stored で，大きさは scalar_size)
+//   float   葉のバウンディングボックス [leaves][2][N] (lo, scale．KdQuant16 のときだけ)
+//   float   葉の座標の誤差 [leaves] (T が double でないときだけ)
+//   Point   葉の点 [leaves][B] (T が double でなく flags に KDFLAT_POINTS があるときだけ)
+// 各セクションはファイルの先頭から KDFLAT_ALIGN バイト境界に置き，位置は offset[] に持つ．
+// 値は書き出した計算機のバイト順のままで，endian にはそのバイト順で 0x01020304 を書く
+// (読み込む計算機とバイト順が違えば読み込まない)
+//
+static const char KDFLAT_MAGIC[8] = {'K', 'D', 'F', 'L', 'A', 'T', 'B', 'N'};
+static const uint32_t KDFLAT_ENDIAN = 0x01020304u;
+static const uint32_t KDFLAT_VERSION = 2;
+static const int64_t KDFLAT_ALIGN = 64;
+static const int32_t KDFLAT_POINTS = 1;  // 点 (double) を含む
+
+struct KdFlatFileHeader {
+  enum { Points, LeafBegin, Split, Axis, Index, Coord, Box, Error, LeafPoints, Sections };
+
+  char magic[8];
+  uint32_t endian;
+  uint32_t version;
+  int32_t dim;          // N
+  int32_t bucket;       // B
+  int32_t scalar_size;  // 座標の型のバイト数
+  int32_t flags;
+  int64_t n;            // 点の数
+  int64_t leaves;       // 葉の数
+  int64_t offset[Sections];
+  int64_t file_size;
+};
+
+//
+// N次元 kD-Tree クラス (ポインタを持たない版)
+// - KdTree<N> と同じ nnSearch / knnSearch / radiusSearch を持つ
+// - 葉は B 個までの点を持つ (B はテンプレートで指定)．葉の数 L は L * B >= n となる
+//   最小の 2 のべき乗で，木は完全二分木になる．内部ノード h (0 <= h < L - 1) の子は
+//   2h + 1, 2h + 2，葉 j はノード L - 1 + j である．子のポインタや KdNode の確保はない
+// - 葉 j の点は，並べ替えた点列の [j * n / L, (j + 1) * n / L) である．
+//   座標は葉ごとに [軸][B] の並び (structure of arrays) で持ち，余りは無限大で埋める．
+//   葉の中の距離の計算は長さ B の単純なループなので，コンパイラがベクトル化する
+// - 枝刈りはすべて2乗距離で行い，平方根は nnSearch の min_dis にだけ使う
+// - split_[h]: 内部ノードの分割値, axis_[h]: 分割軸．分割軸は範囲の点の広がりが
+//   最大の軸で，分割は std::nth_element で行う
+//   (座標が等しい点はインデックスの順とするので，木は点列だけで決まる)
+// - setNumThreads() で 2 以上を指定すると並列に構築する．上位のレベルは
+//   1 つの区間の分割をすべてのスレッドで行い，区間がスレッド数より多くなったら
+//   部分木を TaskPool (work-stealing) のタスクとして構築する．
+//   分割の結果は上の順序だけで決まるので，木はスレッド数によらず同じになる
+// - knnSearchBatch / radiusSearchBatch は多数のクエリを numThreads() 個の
+//   スレッドで探索する．作業領域はスレッドごとに 1 つで，クエリごとの確保はない．
+//   setMortonQueries(true) にすると，クエリを Morton 順に並べ替えてから探索する
+//   (続けて探索するクエリが近いので木の同じ部分がキャッシュに残る)．結果はクエリの順のまま
+// - KdApprox を渡すと，枝刈りを (1 + eps) 倍に緩め，調べる葉の数に上限を付けた
+//   近似探索になる．knnRecall() で厳密な探索に対する再現率を調べられる
+// - allKnn() はすべての点の K近傍点 (kNN グラフ) を，クエリ側の葉ごとに同じ木をたどって
+//   求める (葉の点で候補の上限を共有する)．knnSearchBatch() で n 回探索するより速いのは
+//   低い次元と重複の多い点のときで，何倍も速くなるわけではない (allKnn() を参照)
+// - save() は木と点をバイナリファイルに書き出す．load() はファイルをメモリにマップして
+//   ヘッダを確かめるだけで，配列はマップしたファイルをそのまま参照する (読み込みや
+//   コピーはなく，ページは探索で触れたときに読み込まれる)．読み込んだ木の points() は空で，
+//   点は point(i) で参照する
+// - T は葉の座標の型 (KdScalar を参照)．float は double の 1/2，KdQuant16 は 1/4 の大きさで，
+//   葉の中の距離は float で計算する．元の点 (double) を持つとき (setKeepPoints(true)，既定) は，
+//   葉ごとの座標の誤差の上限で近似の距離から候補を選び，候補だけ元の点で距離を計算し直す
+//   (re-rank) ので，結果は T = double と同じになる．元の点は葉の順 ([葉][B]) に持つので，
+//   re-rank で読む点は葉の座標と同じくまとまっている (points() は空で point(i) は使えない)．
+//   setKeepPoints(false) で構築すると元の点を持たず (メモリは座標とインデックスだけ)，
+//   探索の距離は T の精度の近似になる
+//
+template<int N, int B = 16, class T = double>
+class KdTreeFlat {
+
+  static_assert(B >= 1, "KdTreeFlat: bucket size must be positive");
+
+public:
+
+  typedef Eigen::Vector<double,N> Point;
+  typedef typename KdScalar<T>::Stored Stored;
+  typedef typename KdScalar<T>::Real Real;
+  enum { Bucket = B, Quantized = KdScalar<T>::Quantized };
+
+  static_assert(sizeof(Point) == N * sizeof(double), "KdTreeFlat: Point must be packed");
+
+  KdTreeFlat() : nthreads_(1), morton_(false), keep_points_(true), n_(0), leaves_(0),
+                 has_points_(false) { bind(); };
+  ~KdTreeFlat() {};
+
+  // 配列を参照するポインタはコピー先の配列 (またはマップしたファイル) に付け替える
+  KdTreeFlat(const KdTreeFlat& t) { *this = t; };
+  KdTreeFlat(KdTreeFlat&& t) { *this = std::move(t); };
+  KdTreeFlat& operator=(const KdTreeFlat& t) {
+    if (this != &t) {
+      assign(t);
+      points_buf_ = t.points_buf_;
+      leaf_begin_buf_ = t.leaf_begin_buf_;
+      split_buf_ = t.split_buf_;
+      axis_buf_ = t.axis_buf_;
+      index_buf_ = t.index_buf_;
+      coord_buf_ = t.coord_buf_;
+      box_buf_ = t.box_buf_;
+      error_buf_ = t.error_buf_;
+      leaf_points_buf_ = t.leaf_points_buf_;
+      bind();
+    }
+    return *this;
+  };
+  KdTreeFlat& operator=(KdTreeFlat&& t) {
+    if (this != &t) {
+      assign(t);
+      points_buf_ = std::move(t.points_buf_);
+      leaf_begin_buf_ = std::move(t.leaf_begin_buf_);
+      split_buf_ = std::move(t.split_buf_);
+      axis_buf_ = std::move(t.axis_buf_);
+      index_buf_ = std::move(t.index_buf_);
+      coord_buf_ = std::move(t.coord_buf_);
+      box_buf_ = std::move(t.box_buf_);
+      error_buf_ = std::move(t.error_buf_);
+      leaf_points_buf_ = std::move(t.leaf_points_buf_);
+      bind();
+      t.clear();
+    }
+    return *this;
+  };
+
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
+  // バッチ探索のクエリを Morton 順に並べ替えて探索するか
+  void setMortonQueries(bool f) { morton_ = f; };
+  bool mortonQueries() const { return morton_; };
+
+  // 構築するときに元の点 (double) を持つか (T が double でなければ，持つと探索は厳密になる)
+  void setKeepPoints(bool f) { keep_points_ = f; };
+  bool keepPoints() const { return keep_points_; };
+
+  // 構築した木の点 (元の順)．load() で読み込んだ木では空なので point(i) を使う．
+  // どちらも T = double で元の点を持つ木 (hasPoints() が true) だけで使える．
+  // 書き換えると point(i) のポインタが無効になるので const でだけ返す
+  const std::vector<Point>& points() const { return points_buf_; };
+  const Point& point(int i) const {
+    assert(Exact && has_points_);  // T != double や setKeepPoints(false) では元の順の点はない
+    return points_[i];
+  };
+  bool hasPoints() const { return has_points_; };
+  int size() const { return n_; };
+  // load() でマップしたファイルを参照しているか
+  bool mapped() const { return (bool)file_; };
+
+  // 葉の数と内部ノード h (0 <= h < leaves_size() - 1) の分割値，分割軸
+  int leaves_size() const { return leaves_; };
+  double split(int h) const { return split_[h]; };
+  int axis(int h) const { return axis_[h]; };
+  // 葉 j の i 番目 (0 <= i < B) の点のインデックス (空きは -1)
+  int index(int j, int i) const { return index_[(size_t)j * B + i]; };
+
+  // kD-Tree の構築
+  void construct(const std::vector<Point>& points) {
+    file_.reset();
+    const int n = (int)points.size();
+    n_ = n;
+    has_points_ = keep_points_;
+    if (Exact && has_points_)
+      points_buf_ = points;  // 点データをコピー
+    else
+      points_buf_.clear();
+    leaves_ = 1;
+    while ((long long)leaves_ * B < n) leaves_ *= 2;
+
+    // 点と元のインデックスを組にして並べ替える (点を連続した配列で分割する)
+    std::vector<Item> work(n);
+    for (int i = 0; i < n; ++i) {
+      work[i].p = points[i];
+      work[i].idx = i;
+    }
+    leaf_begin_buf_.resize(leaves_ + 1);
+    for (int j = 0; j <= leaves_; ++j)
+      leaf_begin_buf_[j] = (int)((long long)j * n / leaves_);
+    split_buf_.resize(leaves_ - 1);
+    axis_buf_.resize(leaves_ - 1);
+    index_buf_.assign((size_t)leaves_ * B, -1);
+    coord_buf_.assign((size_t)leaves_ * B * N,
+                      Quantized ? (Stored)0 : (Stored)std::numeric_limits<Real>::infinity());
+    box_buf_.assign(Quantized ? (size_t)leaves_ * 2 * N : 0, 0.0f);
+    error_buf_.assign(Exact ? 0 : leaves_, 0.0f);
+    leaf_points_buf_.assign((!Exact && has_points_) ? (size_t)leaves_ * B : 0, Point::Zero());
+    bind();
+    if (nthreads_ > 1)
+      constructParallel(work);
+    else
+      constructNode(work, 0, 0, leaves_);
+
+    // 葉ごとの座標 (structure of arrays) と点のインデックス
+    // (葉の中の順は分割の経過によるので，インデックスの順に並べ直す)
+    parallelFor(leaves_, nthreads_, [&](int begin, int end) {
+      for (int j = begin; j < end; ++j) {
+        std::sort(work.begin() + leaf_begin_[j], work.begin() + leaf_begin_[j + 1],
+                  [](const Item& a, const Item& b) { return a.idx < b.idx; });
+        for (int k = leaf_begin_[j]; k < leaf_begin_[j + 1]; ++k)
+          index_buf_[(size_t)j * B + k - leaf_begin_[j]] = work[k].idx;
+        storeLeaf(j, work.data() + leaf_begin_[j]);
+      }
+    }, 256);
+  };
+
+  void clear() {
+    file_.reset();
+    n_ = 0;
+    leaves_ = 0;
+    has_points_ = false;
+    points_buf_.clear();
+    leaf_begin_buf_.clear();
+    split_buf_.clear();
+    axis_buf_.clear();
+    index_buf_.clear();
+    coord_buf_.clear();
+    box_buf_.clear();
+    error_buf_.clear();
+    leaf_points_buf_.clear();
+    bind();
+  };
+
+  // 木と点をバイナリファイルに書き出す (書き出せなければ false)
+  bool save(const char* filename) const {
+    KdFlatFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, KDFLAT_MAGIC, 8);
+    h.endian = KDFLAT_ENDIAN;
+    h.version = KDFLAT_VERSION;
+    h.dim = N;
+    h.bucket = B;
+    h.scalar_size = (int32_t)sizeof(Stored);
+    h.flags = has_points_ ? KDFLAT_POINTS : 0;
+    h.n = n_;
+    h.leaves = leaves_;
+    const void* data[KdFlatFileHeader::Sections];
+    int64_t bytes[KdFlatFileHeader::Sections];
+    sections(h, bytes);
+    data[KdFlatFileHeader::Points] = points_;
+    data[KdFlatFileHeader::LeafBegin] = leaf_begin_;
+    data[KdFlatFileHeader::Split] = split_;
+    data[KdFlatFileHeader::Axis] = axis_;
+    data[KdFlatFileHeader::Index] = index_;
+    data[KdFlatFileHeader::Coord] = coord_;
+    data[KdFlatFileHeader::Box] = box_;
+    data[KdFlatFileHeader::Error] = error_;
+    data[KdFlatFileHeader::LeafPoints] = leaf_points_;
+    int64_t pos = (int64_t)sizeof(h);
+    for (int s = 0; s < KdFlatFileHeader::Sections; ++s) {
+      pos = (pos + KDFLAT_ALIGN - 1) / KDFLAT_ALIGN * KDFLAT_ALIGN;
+      h.offset[s] = pos;
+      pos += bytes[s];
+    }
+    h.file_size = pos;
+
+    FILE* fp = fopen(filename, "wb");
+    if (fp == nullptr) {
+      std::cerr << "Error: cannot open " << filename << ". " << std::endl;
+      return false;
+    }
+    static const char zero[KDFLAT_ALIGN] = {0};
+    bool ok = (fwrite(&h, sizeof(h), 1, fp) == 1);
+    pos = (int64_t)sizeof(h);
+    for (int s = 0; ok && (s < KdFlatFileHeader::Sections); ++s) {
+      const size_t pad = (size_t)(h.offset[s] - pos);
+      ok = (fwrite(zero, 1, pad, fp) == pad) &&
+           ((bytes[s] == 0) || (fwrite(data[s], (size_t)bytes[s], 1, fp) == 1));
+      pos = h.offset[s] + bytes[s];
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (ok == false) std::cerr << "Error: cannot write " << filename << ". " << std::endl;
+    return ok;
+  };
+
+  // save() で書き出したファイルをメモリにマップして木にする (読み込めなければ false で，
+  // 木は変わらない)．配列はマップしたファイルを参照し，木を clear() するか作り直すまで
+  // (コピーした木があればそのすべてが) マップを保つ
+  bool load(const char* filename) {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+    if (file->open(filename) == false) {
+      std::cerr << "Error: cannot open " << filename << ". " << std::endl;
+      return false;
+    }
+    const char* error = checkHeader(file->data(), file->size());
+    if (error) {
+      std::cerr << "Error: " << filename << ": " << error << ". " << std::endl;
+      return false;
+    }
+    clear();
+    const KdFlatFileHeader* h = (const KdFlatFileHeader*)file->data();
+    n_ = (int)h->n;
+    leaves_ = (int)h->leaves;
+    has_points_ = (h->flags & KDFLAT_POINTS) != 0;
+    file_ = file;
+    bind();
+    return true;
+  };
+
+  // 最近傍点の探索: 最近傍点の点のインデックスを返す (点がなければ -1)
+  // q: クエリ点
+  // min_dis: 最短距離
+  int nnSearch(const Point& query, double* min_dis = nullptr) const {
+    return nnSearch(query, KdApprox(), min_dis);
+  };
+
+  // 最近傍点の近似探索 (KdApprox を参照)
+  int nnSearch(const Point& query, const KdApprox& approx, double* min_dis = nullptr) const {
+    int index = -1;
+    double d2 = std::numeric_limits<double>::max();
+    if ((size() > 0) && (approx.max_leaves > 0)) {
+      KdQueryContext ctx;
+      knnQuery(query, 1, ctx, approx);
+      index = ctx.heap[0].second;
+      d2 = ctx.heap[0].first;
+    } else if (size() > 0) {
+      nnNode(query, 0, &index, &d2, Visit(approx).f);
+    }
+    if (min_dis) *min_dis = (index >= 0) ? std::sqrt(d2) : d2;
+    return index;
+  };
+
+  // K近傍点の探索: k個の近傍点のインデックス列を距離の近い順に返す
+  // q: クエリ点
+  // k: 近傍点の数
+  std::vector<int> knnSearch(const Point& query, int k) const {
+    return knnSearch(query, k, KdApprox());
+  };
+
+  // K近傍点の近似探索 (KdApprox を参照)
+  std::vector<int> knnSearch(const Point& query, int k, const KdApprox& approx) const {
+    KdQueryContext ctx;
+    knnSearch(query, k, ctx, approx);
+    return std::move(ctx.indices);
+  };
+
+  // K近傍点の探索 (作業領域 ctx を使い回す): 近傍点を距離の近い順に
+  // ctx.indices, ctx.dist2 に入れ，その数を返す
+  int knnSearch(const Point& query, int k, KdQueryContext& ctx,
+                const KdApprox& approx = KdApprox()) const {
+    ctx.heap.clear();
+    ctx.heap.reserve(std::max(0, std::min(k, size())));
+    if ((k > 0) && (size() > 0)) knnQuery(query, k, ctx, approx);
+    std::sort_heap(ctx.heap.begin(), ctx.heap.end());
+    const int n = (int)ctx.heap.size();
+    ctx.indices.resize(n);
+    ctx.dist2.resize(n);
+    for (int i = 0; i < n; ++i) {
+      ctx.indices[i] = ctx.heap[i].second;
+      ctx.dist2[i] = ctx.heap[i].first;
+    }
+    return n;
+  };
+
+  // 半径探索: 半径r内の近傍点のインデックス列を返す (順番は不定)
+  // q: クエリ点
+  // r: 半径
+  std::vector<int> radiusSearch(const Point& q, double r) const {
+    std::vector<int> indices;
+    if ((r >= 0.0) && (size() > 0))
+      radiusNode(q, r * r, 0, [&](int i, double) { indices.push_back(i); });
+    return indices;
+  };
+
+  // 半径探索 (作業領域 ctx を使い回す): 半径r内の近傍点を ctx.indices, ctx.dist2 に入れ，
+  // その数を返す (順番は不定)
+  int radiusSearch(const Point& q, double r, KdQueryContext& ctx) const {
+    ctx.indices.clear();
+    ctx.dist2.clear();
+    if ((r >= 0.0) && (size() > 0))
+      radiusNode(q, r * r, 0, [&](int i, double d2) {
+        ctx.indices.push_back(i);
+        ctx.dist2.push_back(d2);
+      });
+    return ctx.size();
+  };
+
+  // K近傍点のバッチ探索: queries[0, nq) のそれぞれについて距離の近い順に
+  // min(k, size()) 個の近傍点を result に格納する (approx を指定すると近似探索)
+  void knnSearchBatch(const Point* queries, int nq, int k, KdBatchResult& result,
+                      const KdApprox& approx = KdApprox()) const {
+    const int kk = std::max(0, std::min(k, size()));
+    result.offsets.resize(nq + 1);
+    for (int i = 0; i <= nq; ++i) result.offsets[i] = i * kk;
+    result.indices.resize((size_t)nq * kk);
+    result.dist2.resize((size_t)nq * kk);
+    if (kk == 0) return;
+
+    std::vector<int> order;
+    queryOrder(queries, nq, order);
+    std::vector<KdQueryContext> ctx(nthreads_);
+    batchFor(nq, [&](int t, int begin, int end) {
+      KdHeap& heap = ctx[t].heap;
+      for (int pos = begin; pos < end; ++pos) {
+        const int i = order.empty() ? pos : order[pos];
+        heap.clear();
+        knnQuery(queries[i], kk, ctx[t], approx);
+        std::sort_heap(heap.begin(), heap.end());
+        int* idx = result.indices.data() + (size_t)i * kk;
+        double* d2 = result.dist2.data() + (size_t)i * kk;
+        for (int j = 0; j < kk; ++j) {
+          idx[j] = heap[j].second;
+          d2[j] = heap[j].first;
+        }
+      }
+    });
+  };
+  void knnSearchBatch(const std::vector<Point>& queries, int k, KdBatchResult& result,
+                      const KdApprox& approx = KdApprox()) const {
+    knnSearchBatch(queries.data(), (int)queries.size(), k, result, approx);
+  };
+
+  // 近似探索の再現率: queries のそれぞれについて，近似探索で得た k 個のうち
+  // 厳密な k 近傍に含まれるものの割合の平均を返す
+  double knnRecall(const std::vector<Point>& queries, int k, const KdApprox& approx) const {
+    KdBatchResult exact, result;
+    knnSearchBatch(queries, k, exact);
+    knnSearchBatch(queries, k, result, approx);
+    if (exact.indices.empty()) return 1.0;
+    std::atomic<long long> found(0);
+    parallelFor((int)queries.size(), nthreads_, [&](int begin, int end) {
+      long long c = 0;
+      for (int i = begin; i < end; ++i) {
+        const int* e = exact.indices.data() + exact.offsets[i];
+        const int* r = result.indices.data() + result.offsets[i];
+        const int n = exact.count(i);
+        // 距離が等しい点は入れ替わり得るので，k 番目の距離以内なら正解とする
+        const double dk = exact.dist2[exact.offsets[i + 1] - 1];
+        for (int j = 0; j < n; ++j)
+          if ((std::find(e, e + n, r[j]) != e + n) ||
+              (result.dist2[result.offsets[i] + j] <= dk))
+            ++c;
+      }
+      found += c;
+    });
+    return (double)found / (double)exact.indices.size();
+  };
+
+  // 半径探索のバッチ探索: queries[0, nq) のそれぞれについて半径 r 内の
+  // 近傍点を result に格納する (クエリごとの順番は不定)
+  void radiusSearchBatch(const Point* queries, int nq, double r, KdBatchResult& result) const {
+    const double r2 = ((r >= 0.0) && (size() > 0)) ? r * r : -1.0;
+    result.offsets.assign(nq + 1, 0);
+
+    std::vector<int> order;
+    queryOrder(queries, nq, order);
+
+    // スレッドごとに結果を溜めて，クエリの区間ごとの位置を覚えておく
+    struct Buffer {
+      std::vector<int> indices;
+      std::vector<double> dist2;
+      std::vector<std::pair<int,size_t> > blocks;  // (区間の先頭の順番, 位置)
+    };
+    std::vector<Buffer> buffers(nthreads_);
+    batchFor(nq, [&](int t, int begin, int end) {
+      Buffer& buf = buffers[t];
+      buf.blocks.push_back(std::make_pair(begin, buf.indices.size()));
+      for (int pos = begin; pos < end; ++pos) {
+        const int i = order.empty() ? pos : order[pos];
+        const size_t c = buf.indices.size();
+        if (r2 >= 0.0)
+          radiusNode(queries[i], r2, 0, [&](int j, double d2) {
+            buf.indices.push_back(j);
+            buf.dist2.push_back(d2);
+          });
+        result.offsets[i + 1] = (int)(buf.indices.size() - c);
+      }
+    });
+    for (int i = 0; i < nq; ++i) result.offsets[i + 1] += result.offsets[i];
+    result.indices.resize(result.offsets[nq]);
+    result.dist2.resize(result.offsets[nq]);
+
+    parallelFor(nthreads_, nthreads_, [&](int tb, int te) {
+      for (int t = tb; t < te; ++t) {
+        const Buffer& buf = buffers[t];
+        for (auto& b : buf.blocks) {
+          const int end = std::min(nq, b.first + BatchBlock);
+          size_t c = b.second;
+          for (int pos = b.first; pos < end; ++pos) {
+            const int i = order.empty() ? pos : order[pos];
+            const int n = result.count(i);
+            std::copy(buf.indices.begin() + c, buf.indices.begin() + c + n,
+                      result.indices.begin() + result.offsets[i]);
+            std::copy(buf.dist2.begin() + c, buf.dist2.begin() + c + n,
+                      result.dist2.begin() + result.offsets[i]);
+            c += n;
+          }
+        }
+      }
+    }, 1);
+  };
+  void radiusSearchBatch(const std::vector<Point>& queries, double r,
+                         KdBatchResult& result) const {
+    radiusSearchBatch(queries.data(), (int)queries.size(), r, result);
+  };
+
+  // すべての点の K近傍点 (kNN グラフ): 点 i の近傍点を距離の近い順に min(k, size() - 1) 個
+  // result の行 i に格納する (点 i 自身は含めない)．
+  // クエリ側の葉ごとに，葉の点の組で候補を作ってから参照側の木を葉のバウンディングボックスに
+  // 近いノードから順にたどる．候補の k 番目の距離の葉の点での最大値を上限として共有し，
+  // ボックスがそれより遠いノードは調べない．参照の葉では点ごとに自分の候補の k 番目の
+  // 距離とボックスを比べてから，葉単位 (B 個ずつ) で距離を計算する．点のない葉は調べない．
+  // 1 コアでの knnSearchBatch() (全点，k + 1 個) に対する速さ (kdbench -a, k = 10):
+  // 一様な 30 万点で N = 2 は 1.8 倍，N = 3 は 1.6 倍，N = 5 は 1.2 倍 (1 万点では 0.9 倍)，
+  // 重複の多い点 (dup) で 2.3 ~ 3 倍．B = 1 の木でも 1.1 ~ 1.4 倍である．
+  // 一様な点では何倍も速くはならないので，主に kNN グラフを 1 回の呼び出しで作るためのものである
+  void allKnn(int k, KdBatchResult& result) const {
+    const int n = size();
+    const int kk = std::max(0, std::min(k, n - 1));
+    result.offsets.resize(n + 1);
+    for (int i = 0; i <= n; ++i) result.offsets[i] = i * kk;
+    result.indices.resize((size_t)n * kk);
+    result.dist2.resize((size_t)n * kk);
+    if (kk == 0) return;
+
+    // ノードのバウンディングボックス (空の葉は lo = +inf, hi = -inf)
+    const int nodes = 2 * leaves_ - 1;
+    AllKnn s;
+    s.k = kk;
+    s.lo.assign((size_t)nodes * N, std::numeric_limits<double>::infinity());
+    s.hi.assign((size_t)nodes * N, -std::numeric_limits<double>::infinity());
+    parallelFor(leaves_, nthreads_, [&](int begin, int end) {
+      for (int j = begin; j < end; ++j) {
+        const size_t h = (size_t)(leaves_ - 1 + j) * N;
+        for (int i = 0; i < leafCount(j); ++i) {
+          const Point p = leafPoint(j, i);
+          for (int d = 0; d < N; ++d) {
+            s.lo[h + d] = std::min(s.lo[h + d], p[d]);
+            s.hi[h + d] = std::max(s.hi[h + d], p[d]);
+          }
+        }
+      }
+    }, 256);
+    for (int h = leaves_ - 2; h >= 0; --h)
+      for (int d = 0; d < N; ++d) {
+        const size_t c1 = (size_t)(2 * h + 1) * N + d, c2 = c1 + N;
+        s.lo[(size_t)h * N + d] = std::min(s.lo[c1], s.lo[c2]);
+        s.hi[(size_t)h * N + d] = std::max(s.hi[c1], s.hi[c2]);
+      }
+
+    // クエリ側の葉ごとに参照側の木をたどる．結果は点 i の行に距離の近い順に書き込む
+    std::vector<AllKnnTask> task(nthreads_);
+    batchFor(leaves_, [&](int t, int begin, int end) {
+      AllKnnTask& a = task[t];
+      for (int jq = begin; jq < end; ++jq) {
+        const int m = leafCount(jq);
+        if (m == 0) continue;
+        allKnnLeaf(s, a, jq);
+        for (int i = 0; i < m; ++i) {
+          const size_t row = (size_t)index_[(size_t)jq * B + i] * kk;
+          std::copy(a.dist2.begin() + (size_t)i * kk, a.dist2.begin() + (size_t)(i + 1) * kk,
+                    result.dist2.begin() + row);
+          std::copy(a.indices.begin() + (size_t)i * kk,
+                    a.indices.begin() + (size_t)(i + 1) * kk, result.indices.begin() + row);
+        }
+      }
+    });
+  };
+
+  //
+  // 複数の木をまとめて探索するための関数 (KdTreeDynamic で使う)
+  //
+
+  // ctx.heap が k 個になるまで，または ctx.heap の最も遠い点より近い点で ctx.heap を更新する．
+  // ctx.heap にほかの木で見つけた点が入っていれば，それより遠い部分木は調べない．
+  // id(i) は点 i をヒープに入れるときの番号を返す (負ならその点は除く)
+  template <class Id>
+  void knnMerge(const Point& q, int k, KdQueryContext& ctx, const Id& id) const {
+    if ((k > 0) && (size() > 0)) knnNode(q, k, ctx.heap, ctx.stack, 1.0, id);
+  };
+
+  // 半径 r 内の点ごとに f(インデックス, 2乗距離) を呼ぶ
+  template <class F>
+  void radiusVisit(const Point& q, double r, F&& f) const {
+    if ((r >= 0.0) && (size() > 0)) radiusNode(q, r * r, 0, f);
+  };
+
+private:
+
+  typedef KdHeap Heap;
+
+  // 点のインデックスをそのまま返す (knnMerge の id)
+  struct Identity {
+    int operator()(int i) const { return i; };
+  };
+
+  // 近似探索の状態: 遠い側の部分木の枝刈り係数 1 / (1 + eps)^2 と残りの葉の数
+  struct Visit {
+    double f;
+    int leaves;
+
+    explicit Visit(const KdApprox& a)
+        : f(1.0 / ((1.0 + a.eps) * (1.0 + a.eps))),
+          leaves((a.max_leaves > 0) ? a.max_leaves : std::numeric_limits<int>::max()) {};
+  };
+
+  // バッチ探索でスレッドが一度に取るクエリの数
+  enum { BatchBlock = 64 };
+
+  // これより少ないクエリは Morton 順に並べ替えない
+  enum { MortonMinQueries = 4096 };
+
+  // バッチ探索のクエリの順番 (並べ替えないときは空)
+  void queryOrder(const Point* queries, int nq, std::vector<int>& order) const {
+    order.clear();
+    if (morton_ && (nq >= MortonMinQueries)) mortonOrder<N>(queries, nq, order, nthreads_);
+  };
+
+  // [0, nq) を BatchBlock 個ずつ空いているスレッドに割り当て，f(スレッド, begin, end) を呼ぶ
+  template <class F>
+  void batchFor(int nq, F&& f) const {
+    std::atomic<int> next(0);
+    parallelFor(nthreads_, nthreads_, [&](int tb, int te) {
+      for (int t = tb; t < te; ++t) {
+        for (;;) {
+          const int begin = next.fetch_add(BatchBlock);
+          if (begin >= nq) break;
+          f(t, begin, std::min(nq, begin + BatchBlock));
+        }
+      }
+    }, 1);
+  };
+
+  // T = double なら葉の座標は元の座標と同じ
+  enum { Exact = std::is_same<T,double>::value };
+
+  struct Item {
+    Point p;
+    int idx;
+  };
+
+  // 軸 a の座標の順 (等しければインデックスの順)
+  struct Less {
+    int a;
+    bool operator()(const Item& i, const Item& j) const {
+      return (i.p[a] < j.p[a]) || ((i.p[a] == j.p[a]) && (i.idx < j.idx));
+    };
+  };
+
+  // これより小さい区間は 1 スレッドで分割する
+  enum { ParallelGrain = 1 << 16, TaskGrain = 1 << 12 };
+
+  // 内部ノード h (葉 [l0, l1)) の分割軸と分割値を決める．
+  // 葉 [l0, lm) の点が分割値以下，[lm, l1) の点が分割値以上になるように並べ替える
+  void splitNode(std::vector<Item>& work, int h, int l0, int lm, int l1) {
+    const int lo = leaf_begin_[l0], m = leaf_begin_[lm], hi = leaf_begin_[l1];
+    const int a = (lo < hi) ? spreadAxis(work, lo, hi) : 0;
+    if (m < hi) std::nth_element(work.begin() + lo, work.begin() + m, work.begin() + hi, Less{a});
+    setSplit(work, h, a, m, hi);
+  };
+
+  void setSplit(const std::vector<Item>& work, int h, int a, int m, int hi) {
+    axis_buf_[h] = (uint8_t)a;
+    // 右が空のとき (B = 1 で点が少ない場合) はすべて左に進むようにする
+    split_buf_[h] = (m < hi) ? work[m].p[a] : std::numeric_limits<double>::infinity();
+  };
+
+  // ノード h (葉 [l0, l1)) の部分木を構築する
+  void constructNode(std::vector<Item>& work, int h, int l0, int l1) {
+    while (l1 - l0 > 1) {
+      const int lm = (l0 + l1) / 2;
+      splitNode(work, h, l0, lm, l1);
+      constructNode(work, 2 * h + 1, l0, lm);
+      h = 2 * h + 2;
+      l0 = lm;
+    }
+  };
+
+  // [lo, hi) の点の広がりが最大の軸
+  static int spreadAxis(const std::vector<Item>& work, int lo, int hi) {
+    Point mn = work[lo].p, mx = mn;
+    for (int i = lo + 1; i < hi; ++i) {
+      mn = mn.cwiseMin(work[i].p);
+      mx = mx.cwiseMax(work[i].p);
+    }
+    int a;
+    (mx - mn).maxCoeff(&a);
+    return a;
+  };
+
+  // 並列構築
+  struct Range {
+    int h, l0, l1;
+  };
+
+  void constructParallel(std::vector<Item>& work) {
+    const int nt = nthreads_;
+    std::vector<Item> tmp(work.size());
+
+    // 上位のレベル: ノードごとにすべてのスレッドで分割する
+    std::vector<Range> ranges(1, Range{0, 0, leaves_}), next;
+    auto points = [&](const Range& r) { return leaf_begin_[r.l1] - leaf_begin_[r.l0]; };
+    while (((int)ranges.size() < nt) && (ranges[0].l1 - ranges[0].l0 > 1) &&
+           (points(ranges[0]) > ParallelGrain)) {
+      next.clear();
+      for (auto& r : ranges) {
+        const int lm = (r.l0 + r.l1) / 2;
+        const int lo = leaf_begin_[r.l0], m = leaf_begin_[lm], hi = leaf_begin_[r.l1];
+        const int a = spreadAxisParallel(work, lo, hi);
+        selectParallel(work, tmp, lo, m, hi, a);
+        setSplit(work, r.h, a, m, hi);
+        next.push_back(Range{2 * r.h + 1, r.l0, lm});
+        next.push_back(Range{2 * r.h + 2, lm, r.l1});
+      }
+      ranges.swap(next);
+    }
+
+    // 残りの部分木はタスクとして構築する
+    TaskPool pool(nt);
+    pool.run([&]() {
+      for (auto& r : ranges) {
+        const Range rr = r;
+        pool.spawn([&, rr]() { constructTask(pool, work, rr); });
+      }
+    });
+  };
+
+  // 大きい部分木は分割して右の部分木を新しいタスクにする
+  void constructTask(TaskPool& pool, std::vector<Item>& work, Range r) {
+    while ((r.l1 - r.l0 > 1) && (leaf_begin_[r.l1] - leaf_begin_[r.l0] > TaskGrain)) {
+      const int lm = (r.l0 + r.l1) / 2;
+      splitNode(work, r.h, r.l0, lm, r.l1);
+      const Range right{2 * r.h + 2, lm, r.l1};
+      pool.spawn([&, right]() { constructTask(pool, work, right); });
+      r = Range{2 * r.h + 1, r.l0, lm};
+    }
+    constructNode(work, r.h, r.l0, r.l1);
+  };
+
+  int spreadAxisParallel(const std::vector<Item>& work, int lo, int hi) const {
+    const int nt = nthreads_;
+    std::vector<Point> mn(nt, work[lo].p), mx(nt, work[lo].p);
+    parallelFor(nt, nt, [&](int tb, int te) {
+      for (int t = tb; t < te; ++t) {
+        const int b = lo + (int)((long long)(hi - lo) * t / nt);
+        const int e = lo + (int)((long long)(hi - lo) * (t + 1) / nt);
+        for (int i = b; i < e; ++i) {
+          mn[t] = mn[t].cwiseMin(work[i].p);
+          mx[t] = mx[t].cwiseMax(work[i].p);
+        }
+      }
+    }, 1);
+    for (int t = 1; t < nt; ++t) {
+      mn[0] = mn[0].cwiseMin(mn[t]);
+      mx[0] = mx[0].cwiseMax(mx[t]);
+    }
+    int a;
+    (mx[0] - mn[0]).maxCoeff(&a);
+    return a;
+  };
+
+  // [lo, hi) を，k 番目の点 (Less の順) が work[k] に来るように並列に分割する．
+  // 標本から選んだ pivot で 3 つ (pivot より前, pivot, 後) に分けることを
+  // 区間が小さくなるまで繰り返し，最後は std::nth_element で分割する．
+  void selectParallel(std::vector<Item>& work, std::vector<Item>& tmp, int lo, int k,
+                      int hi, int a) const {
+    const int nt = nthreads_;
+    const Less less{a};
+    std::vector<Item> sample;
+    std::vector<int> count(nt), count_back(nt);
+    while (hi - lo > ParallelGrain) {
+      // 標本の k に当たる順位の点を pivot にする
+      const int ns = 255;
+      sample.resize(ns);
+      for (int i = 0; i < ns; ++i)
+        sample[i] = work[lo + (int)((long long)(hi - lo) * (2 * i + 1) / (2 * ns))];
+      const int sk = (int)((long long)ns * (k - lo) / (hi - lo));
+      std::nth_element(sample.begin(), sample.begin() + sk, sample.end(), less);
+      const Item pivot = sample[sk];
+
+      auto chunk = [&](int t, int* b, int* e) {
+        *b = lo + (int)((long long)(hi - lo) * t / nt);
+        *e = lo + (int)((long long)(hi - lo) * (t + 1) / nt);
+      };
+      parallelFor(nt, nt, [&](int tb, int te) {
+        for (int t = tb; t < te; ++t) {
+          int b, e, c = 0, g = 0;
+          chunk(t, &b, &e);
+          for (int i = b; i < e; ++i) {
+            if (less(work[i], pivot))
+              ++c;
+            else if (less(pivot, work[i]))
+              ++g;
+          }
+          count[t] = c;
+          count_back[t] = g;
+        }
+      }, 1);
+      int m = lo;
+      for (int t = 0; t < nt; ++t) {
+        const int c = count[t];
+        count[t] = m;
+        m += c;
+      }
+      for (int t = 0, g = m + 1; t < nt; ++t) {
+        const int c = count_back[t];
+        count_back[t] = g;
+        g += c;
+      }
+      // pivot より前は [lo, m), pivot は m, 後は (m, hi) に移す
+      parallelFor(nt, nt, [&](int tb, int te) {
+        for (int t = tb; t < te; ++t) {
+          int b, e;
+          chunk(t, &b, &e);
+          int front = count[t];
+          int back = count_back[t];
+          for (int i = b; i < e; ++i) {
+            if (less(work[i], pivot))
+              tmp[front++] = work[i];
+            else if (less(pivot, work[i]))
+              tmp[back++] = work[i];
+          }
+        }
+      }, 1);
+      tmp[m] = pivot;
+      parallelFor(hi - lo, nt, [&](int b, int e) {
+        std::copy(tmp.begin() + lo + b, tmp.begin() + lo + e, work.begin() + lo + b);
+      });
+      if (k == m) return;
+      if (k < m)
+        hi = m;
+      else
+        lo = m + 1;
+    }
+    if (k < hi) std::nth_element(work.begin() + lo, work.begin() + k, work.begin() + hi, less);
+  };
+
+  // 葉 j の B 個の点までの2乗距離を Real で d2 に求める (空きの値は使わない)．
+  // T が double でなければ近似の距離で，元の点の距離との差は threshold() で見積もる
+  void leafDistances(int j, const Point& q, Real* d2) const {
+    const Stored* c = coord_ + (size_t)j * B * N;
+    for (int d = 0; d < N; ++d) {
+      const Real qd = (Real)q[d];
+      const Stored* cd = c + d * B;
+      const Real lo = Quantized ? box_[(size_t)j * 2 * N + d] : (Real)0;
+      const Real scale = Quantized ? box_[(size_t)j * 2 * N + N + d] : (Real)1;
+      if (d == 0) {
+        for (int i = 0; i < B; ++i) {
+          const Real t = (Quantized ? lo + scale * (Real)cd[i] : (Real)cd[i]) - qd;
+          d2[i] = t * t;
+        }
+      } else {
+        for (int i = 0; i < B; ++i) {
+          const Real t = (Quantized ? lo + scale * (Real)cd[i] : (Real)cd[i]) - qd;
+          d2[i] += t * t;
+        }
+      }
+    }
+  };
+
+  // 元の点で距離を計算し直すか (T が double でなく，元の点を持つとき)
+  bool rerank() const { return !Exact && has_points_; };
+
+  // 葉 j の近似の2乗距離の閾値: leafDistances() の値がこれ以上の点は，元の点の2乗距離も
+  // w 以上である．葉の座標の誤差 error_[j]，クエリを float にした誤差，float の計算の
+  // 丸めの分だけ距離を広げる (re-rank しないときは w)
+  double threshold(int j, const Point& q, double w) const {
+    if ((rerank() == false) || !(w < std::numeric_limits<double>::infinity())) return w;
+    const double u = std::numeric_limits<float>::epsilon();
+    const double qerr = std::sqrt((double)N) * u * q.cwiseAbs().maxCoeff();
+    const double t = (std::sqrt(w) + error_[j] + qerr) * (1.0 + (N + 4) * u);
+    return t * t;
+  };
+
+  // 葉 j の i 番目の点の2乗距離 (re-rank するときは元の点で計算し直す)
+  double exactDistance(int j, int i, const Point& q, Real d2) const {
+    if (rerank() == false) return d2;
+    return (leaf_points_[(size_t)j * B + i] - q).squaredNorm();
+  };
+
+  // 葉 j の i 番目の点の座標 (re-rank するときは元の点)
+  Point leafPoint(int j, int i) const {
+    if (rerank()) return leaf_points_[(size_t)j * B + i];
+    const Stored* c = coord_ + (size_t)j * B * N;
+    Point p;
+    for (int d = 0; d < N; ++d) {
+      if (Quantized) {
+        const float* box = box_ + (size_t)j * 2 * N;
+        p[d] = box[d] + box[N + d] * (Real)c[d * B + i];
+      } else {
+        p[d] = (double)c[d * B + i];
+      }
+    }
+    return p;
+  };
+
+  // 葉 j の座標 (items は葉の点 leafCount(j) 個) を書き込む．
+  // T が double でなければ，葉の中で距離の計算に使う座標と元の座標の距離の最大値に
+  // 計算の順 (FMA の有無) による丸めの分を足して error_buf_[j] にし，
+  // 元の点を持つなら leaf_points_buf_ に葉の順で書き込む
+  void storeLeaf(int j, const Item* items) {
+    const int m = leafCount(j);
+    Stored* c = coord_buf_.data() + (size_t)j * B * N;
+    float* box = Quantized ? box_buf_.data() + (size_t)j * 2 * N : nullptr;
+    if (Quantized) {
+      for (int d = 0; d < N; ++d) {
+        double mn = (m > 0) ? items[0].p[d] : 0.0, mx = mn;
+        for (int i = 1; i < m; ++i) {
+          mn = std::min(mn, items[i].p[d]);
+          mx = std::max(mx, items[i].p[d]);
+        }
+        box[d] = (float)mn;
+        box[N + d] = (float)((mx - box[d]) / 65535.0);
+      }
+    }
+    double err = 0.0, mag = 0.0;
+    for (int i = 0; i < m; ++i) {
+      double e2 = 0.0;
+      for (int d = 0; d < N; ++d) {
+        const double x = items[i].p[d];
+        Real y;
+        if (Quantized) {
+          const double u = (box[N + d] > 0.0f) ? std::round((x - box[d]) / box[N + d]) : 0.0;
+          c[d * B + i] = (Stored)std::min(65535.0, std::max(0.0, u));
+          y = box[d] + box[N + d] * (Real)c[d * B + i];
+        } else {
+          c[d * B + i] = (Stored)x;
+          y = (Real)c[d * B + i];
+        }
+        e2 += (x - y) * (x - y);
+        mag = std::max(mag, std::abs((double)y));
+      }
+      err = std::max(err, std::sqrt(e2));
+      if (rerank()) leaf_points_buf_[(size_t)j * B + i] = items[i].p;
+    }
+    if (!Exact) {
+      err += std::sqrt((double)N) * 2.0 * std::numeric_limits<float>::epsilon() * mag;
+      error_buf_[j] = std::nextafter((float)err, std::numeric_limits<float>::infinity());
+    }
+  };
+
+  int leafCount(int j) const { return leaf_begin_[j + 1] - leaf_begin_[j]; };
+
+  // 最近傍点探索 再帰関数
+  // (f は近似探索の枝刈り係数 1 / (1 + eps)^2，厳密な探索では 1)
+  void nnNode(const Point& q, int h, int* index, double* best, double f) const {
+    while (h < leaves_ - 1) {
+      const double diff = q[axis_[h]] - split_[h];
+      // 近い側を先に探索し，遠い側は分割面までの距離が最短距離より近いときだけ探索する
+      const int near = 2 * h + ((diff < 0.0) ? 1 : 2);
+      nnNode(q, near, index, best, f);
+      if (diff * diff >= *best * f) return;
+      h = (diff < 0.0) ? near + 1 : near - 1;
+    }
+    const int j = h - (leaves_ - 1);
+    Real d2[B];
+    leafDistances(j, q, d2);
+    const int m = leafCount(j);
+    double limit = threshold(j, q, *best);
+    for (int i = 0; i < m; ++i) {
+      if (d2[i] >= limit) continue;
+      const double e = exactDistance(j, i, q, d2[i]);
+      if (e < *best) {
+        *best = e;
+        *index = index_[(size_t)j * B + i];
+        limit = threshold(j, q, *best);
+      }
+    }
+  };
+
+  // K近傍点探索: ctx.heap を更新する
+  // approx.max_leaves > 0 なら best-bin-first，それ以外は深さ優先で探索する
+  void knnQuery(const Point& q, int k, KdQueryContext& ctx, const KdApprox& approx) const {
+    Visit v(approx);
+    if (approx.max_leaves > 0)
+      knnBest(q, k, ctx.heap, ctx.stack, v);
+    else
+      knnNode(q, k, ctx.heap, ctx.stack, v.f, Identity());
+  };
+
+  // K近傍点探索 (深さ優先): 近い側の子をたどり，遠い側の子を (距離の下限, ノード) として
+  // stack に積む．stack の大きさは木の深さまでである
+  template <class Id>
+  void knnNode(const Point& q, int k, Heap& heap, Heap& stack, double f, const Id& id) const {
+    stack.clear();
+    stack.reserve(32);  // 木の深さは 31 以下
+    stack.push_back(std::make_pair(0.0, 0));
+    while (!stack.empty()) {
+      const double b = stack.back().first;
+      int h = stack.back().second;
+      stack.pop_back();
+      if (((int)heap.size() == k) && (b >= heap.front().first * f)) continue;
+      while (h < leaves_ - 1) {
+        const double diff = q[axis_[h]] - split_[h];
+        const int near = 2 * h + ((diff < 0.0) ? 1 : 2);
+        const int far = (diff < 0.0) ? near + 1 : near - 1;
+        stack.push_back(std::make_pair(std::max(b, diff * diff), far));
+        h = near;
+      }
+      knnLeaf(q, k, h - (leaves_ - 1), heap, id);
+    }
+  };
+
+  // K近傍点の近似探索 (best-bin-first): 分割面までの距離 (の下限) が近い部分木から順に調べ，
+  // 葉を v.leaves 個調べたら (k 個見つかっていれば) 終わる．
+  // branches は (距離の下限, ノード) の最小ヒープ
+  void knnBest(const Point& q, int k, Heap& heap, Heap& branches, Visit& v) const {
+    const std::greater<std::pair<double,int> > greater;
+    branches.clear();
+    branches.push_back(std::make_pair(0.0, 0));
+    while (!branches.empty()) {
+      std::pop_heap(branches.begin(), branches.end(), greater);
+      const double b = branches.back().first;
+      int h = branches.back().second;
+      branches.pop_back();
+      if (((int)heap.size() == k) && ((v.leaves <= 0) || (b >= heap.front().first * v.f)))
+        break;
+      while (h < leaves_ - 1) {
+        const double diff = q[axis_[h]] - split_[h];
+        const int near = 2 * h + ((diff < 0.0) ? 1 : 2);
+        const double fb = std::max(b, diff * diff);
+        if (((int)heap.size() < k) || (fb < heap.front().first * v.f)) {
+          branches.push_back(std::make_pair(fb, (diff < 0.0) ? near + 1 : near - 1));
+          std::push_heap(branches.begin(), branches.end(), greater);
+        }
+        h = near;
+      }
+      --v.leaves;
+      knnLeaf(q, k, h - (leaves_ - 1), heap, Identity());
+    }
+  };
+
+  // 葉 j の点で K近傍点のヒープを更新する
+  template <class Id>
+  void knnLeaf(const Point& q, int k, int j, Heap& heap, const Id& id) const {
+    Real d2[B];
+    leafDistances(j, q, d2);
+    const int m = leafCount(j);
+    double limit = ((int)heap.size() == k) ? threshold(j, q, heap.front().first)
+                                           : std::numeric_limits<double>::infinity();
+    for (int i = 0; i < m; ++i) {
+      if (d2[i] >= limit) continue;
+      const bool full = ((int)heap.size() == k);
+      const double e = exactDistance(j, i, q, d2[i]);
+      if (full && (e >= heap.front().first)) continue;
+      const int g = id(index_[(size_t)j * B + i]);
+      if (g < 0) continue;
+      if (full) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = std::make_pair(e, g);
+      } else {
+        heap.push_back(std::make_pair(e, g));
+      }
+      std::push_heap(heap.begin(), heap.end());
+      if ((int)heap.size() == k) limit = threshold(j, q, heap.front().first);
+    }
+  };
+
+  // allKnn の作業領域
+  struct AllKnn {
+    int k;
+    std::vector<double> lo, hi; // ノードのバウンディングボックス
+  };
+
+  // allKnn のスレッドごとの作業領域: クエリの葉の点 i の近傍点の候補を
+  // dist2 / indices の [i * k, (i + 1) * k) に距離の近い順に持つ (足りない分は +inf)
+  struct AllKnnTask {
+    std::vector<double> dist2;
+    std::vector<int> indices;
+    KdHeap stack;
+  };
+
+  // ノード a, b のバウンディングボックスの2乗距離
+  static double boxDistance(const AllKnn& s, int a, int b) {
+    const double* alo = s.lo.data() + (size_t)a * N;
+    const double* ahi = s.hi.data() + (size_t)a * N;
+    const double* blo = s.lo.data() + (size_t)b * N;
+    const double* bhi = s.hi.data() + (size_t)b * N;
+    double d2 = 0.0;
+    for (int d = 0; d < N; ++d) {
+      const double t = std::max(0.0, std::max(alo[d] - bhi[d], blo[d] - ahi[d]));
+      d2 += t * t;
+    }
+    return d2;
+  };
+
+  // クエリの葉 jq の点の K近傍点: 自分の葉で候補を作ってから，参照側の木を
+  // 葉 jq のバウンディングボックスに近いノードから順にたどる．
+  // 葉 jq の点の候補の k 番目の2乗距離の最大値より遠いノードは調べない
+  void allKnnLeaf(const AllKnn& s, AllKnnTask& a, int jq) const {
+    const int k = s.k;
+    const int m = leafCount(jq);
+    const int hq = leaves_ - 1 + jq;
+    a.dist2.assign((size_t)m * k, std::numeric_limits<double>::infinity());
+    a.indices.assign((size_t)m * k, -1);
+    Point q[B];
+    for (int i = 0; i < m; ++i) q[i] = leafPoint(jq, i);
+
+    // 自分の葉: 点の組ごとに 1 回だけ距離を求めて両方の候補に入れる
+    double bound = 0.0;
+    for (int i = 0; i < m; ++i)
+      for (int t = i + 1; t < m; ++t) {
+        const double e2 = (q[i] - q[t]).squaredNorm();
+        allKnnInsert(a, k, i, e2, index_[(size_t)jq * B + t]);
+        allKnnInsert(a, k, t, e2, index_[(size_t)jq * B + i]);
+      }
+    for (int i = 0; i < m; ++i) bound = std::max(bound, a.dist2[(size_t)i * k + k - 1]);
+    a.stack.clear();
+    a.stack.push_back(std::make_pair(0.0, 0));
+    while (!a.stack.empty()) {
+      const double b = a.stack.back().first;
+      int h = a.stack.back().second;
+      a.stack.pop_back();
+      if (b >= bound) continue;
+      while (h < leaves_ - 1) {
+        int near = 2 * h + 1, far = 2 * h + 2;
+        double dn = boxDistance(s, hq, near), df = boxDistance(s, hq, far);
+        if (df < dn) {
+          std::swap(near, far);
+          std::swap(dn, df);
+        }
+        if (df < bound) a.stack.push_back(std::make_pair(df, far));
+        if (dn >= bound) break;
+        h = near;
+      }
+      if ((h >= leaves_ - 1) && (h != hq)) bound = allKnnRef(s, a, jq, q, m, h - (leaves_ - 1));
+    }
+  };
+
+  // クエリの葉の点 i の候補に (e2, idx) を入れる (k 番目より遠ければ何もしない)
+  static void allKnnInsert(AllKnnTask& a, int k, int i, double e2, int idx) {
+    double* dist = a.dist2.data() + (size_t)i * k;
+    int* id = a.indices.data() + (size_t)i * k;
+    if (e2 >= dist[k - 1]) return;
+    int c = k - 1;
+    while ((c > 0) && (dist[c - 1] > e2)) {
+      dist[c] = dist[c - 1];
+      id[c] = id[c - 1];
+      --c;
+    }
+    dist[c] = e2;
+    id[c] = idx;
+  };
+
+  // クエリの葉 jq の点 q[0, m) の候補を参照の葉 jr の点で更新し，
+  // 候補の k 番目の2乗距離の最大値を返す
+  double allKnnRef(const AllKnn& s, AllKnnTask& a, int jq, const Point* q, int m,
+                   int jr) const {
+    const int k = s.k;
+    const double* rlo = s.lo.data() + (size_t)(leaves_ - 1 + jr) * N;
+    const double* rhi = s.hi.data() + (size_t)(leaves_ - 1 + jr) * N;
+    const int mr = leafCount(jr);
+    double bound = 0.0;
+    for (int i = 0; i < m; ++i) {
+      double* dist = a.dist2.data() + (size_t)i * k;
+      int* idx = a.indices.data() + (size_t)i * k;
+      double worst = dist[k - 1];
+
+      // 点と葉 jr のバウンディングボックスの距離で枝刈りする
+      double box = 0.0;
+      for (int d = 0; d < N; ++d) {
+        const double t = std::max(0.0, std::max(rlo[d] - q[i][d], q[i][d] - rhi[d]));
+        box += t * t;
+      }
+      if (box < worst) {
+        Real d2[B];
+        leafDistances(jr, q[i], d2);
+        double limit = threshold(jr, q[i], worst);
+        for (int t = 0; t < mr; ++t) {
+          if ((d2[t] >= limit) || ((jr == jq) && (t == i))) continue;
+          const double e2 = exactDistance(jr, t, q[i], d2[t]);
+          if (e2 >= worst) continue;
+          // 距離の近い順に並ぶように挿入する
+          int c = k - 1;
+          while ((c > 0) && (dist[c - 1] > e2)) {
+            dist[c] = dist[c - 1];
+            idx[c] = idx[c - 1];
+            --c;
+          }
+          dist[c] = e2;
+          idx[c] = index_[(size_t)jr * B + t];
+          worst = dist[k - 1];
+          limit = threshold(jr, q[i], worst);
+        }
+      }
+      bound = std::max(bound, worst);
+    }
+    return bound;
+  };
+
+  // 半径探索 再帰関数: 半径内の点ごとに f(インデックス, 2乗距離) を呼ぶ
+  template <class F>
+  void radiusNode(const Point& q, double r2, int h, F&& f) const {
+    while (h < leaves_ - 1) {
+      const double diff = q[axis_[h]] - split_[h];
+      const int near = 2 * h + ((diff < 0.0) ? 1 : 2);
+      radiusNode(q, r2, near, f);
+      if (diff * diff > r2) return;
+      h = (diff < 0.0) ? near + 1 : near - 1;
+    }
+    const int j = h - (leaves_ - 1);
+    Real d2[B];
+    leafDistances(j, q, d2);
+    const int m = leafCount(j);
+    const double limit = threshold(j, q, r2);
+    for (int i = 0; i < m; ++i) {
+      if (d2[i] > limit) continue;
+      const double e = exactDistance(j, i, q, d2[i]);
+      if (e <= r2) f(index_[(size_t)j * B + i], e);
+    }
+  };
+
+  //
+  // 配列とファイル
+  //
+
+  // 配列以外のメンバをコピーする
+  void assign(const KdTreeFlat& t) {
+    nthreads_ = t.nthreads_;
+    morton_ = t.morton_;
+    keep_points_ = t.keep_points_;
+    n_ = t.n_;
+    leaves_ = t.leaves_;
+    has_points_ = t.has_points_;
+    file_ = t.file_;
+  };
+
+  // 配列のポインタを *_buf_ かマップしたファイルに合わせる
+  void bind() {
+    if (file_) {
+      const char* base = file_->data();
+      const KdFlatFileHeader* h = (const KdFlatFileHeader*)base;
+      points_ = (const Point*)(base + h->offset[KdFlatFileHeader::Points]);
+      leaf_begin_ = (const int*)(base + h->offset[KdFlatFileHeader::LeafBegin]);
+      split_ = (const double*)(base + h->offset[KdFlatFileHeader::Split]);
+      axis_ = (const uint8_t*)(base + h->offset[KdFlatFileHeader::Axis]);
+      index_ = (const int*)(base + h->offset[KdFlatFileHeader::Index]);
+      coord_ = (const Stored*)(base + h->offset[KdFlatFileHeader::Coord]);
+      box_ = (const float*)(base + h->offset[KdFlatFileHeader::Box]);
+      error_ = (const float*)(base + h->offset[KdFlatFileHeader::Error]);
+      leaf_points_ = (const Point*)(base + h->offset[KdFlatFileHeader::LeafPoints]);
+    } else {
+      points_ = points_buf_.data();
+      leaf_begin_ = leaf_begin_buf_.data();
+      split_ = split_buf_.data();
+      axis_ = axis_buf_.data();
+      index_ = index_buf_.data();
+      coord_ = coord_buf_.data();
+      box_ = box_buf_.data();
+      error_ = error_buf_.data();
+      leaf_points_ = leaf_points_buf_.data();
+    }
+  };
+
+  // ファイルの各セクションのバイト数 (h の flags, n, leaves による)
+  static void sections(const KdFlatFileHeader& h, int64_t* bytes) {
+    const int64_t leaves = h.leaves;
+    const bool points = (h.flags & KDFLAT_POINTS) != 0;
+    bytes[KdFlatFileHeader::Points] = (Exact && points) ? h.n * (int64_t)sizeof(Point) : 0;
+    bytes[KdFlatFileHeader::LeafBegin] = (leaves + 1) * (int64_t)sizeof(int32_t);
+    bytes[KdFlatFileHeader::Split] = (leaves - 1) * (int64_t)sizeof(double);
+    bytes[KdFlatFileHeader::Axis] = (leaves - 1) * (int64_t)sizeof(uint8_t);
+    bytes[KdFlatFileHeader::Index] = leaves * B * (int64_t)sizeof(int32_t);
+    bytes[KdFlatFileHeader::Coord] = leaves * B * N * (int64_t)sizeof(Stored);
+    bytes[KdFlatFileHeader::Box] = Quantized ? leaves * 2 * N * (int64_t)sizeof(float) : 0;
+    bytes[KdFlatFileHeader::Error] = Exact ? 0 : leaves * (int64_t)sizeof(float);
+    bytes[KdFlatFileHeader::LeafPoints] =
+        (!Exact && points) ? leaves * B * (int64_t)sizeof(Point) : 0;
+  };
+
+  // ヘッダがこの木のものか確かめる (正しければ nullptr，違えば理由を返す)．
+  // 配列の中身は確かめない
+  static const char* checkHeader(const char* data, size_t size) {
+    if (size < sizeof(KdFlatFileHeader)) return "file is too short";
+    const KdFlatFileHeader* h = (const KdFlatFileHeader*)data;
+    if (memcmp(h->magic, KDFLAT_MAGIC, 8)) return "not a KdTreeFlat file";
+    if (h->endian != KDFLAT_ENDIAN) return "byte order differs";
+    if (h->version != KDFLAT_VERSION) return "unsupported version";
+    if ((h->dim != N) || (h->bucket != B) || (h->scalar_size != (int32_t)sizeof(Stored)))
+      return "dimension, bucket size or scalar type differs";
+    if ((h->n < 0) || (h->n > std::numeric_limits<int>::max()) || (h->leaves < 1) ||
+        (h->leaves > std::numeric_limits<int>::max()) || (h->leaves & (h->leaves - 1)) ||
+        (h->leaves * B < h->n) || ((h->leaves > 1) && ((h->leaves / 2) * B >= h->n)))
+      return "invalid number of points or leaves";
+    if (h->file_size != (int64_t)size) return "file size differs";
+    int64_t bytes[KdFlatFileHeader::Sections];
+    sections(*h, bytes);
+    for (int s = 0; s < KdFlatFileHeader::Sections; ++s)
+      if ((h->offset[s] < (int64_t)sizeof(KdFlatFileHeader)) || (h->offset[s] % KDFLAT_ALIGN) ||
+          (h->offset[s] + bytes[s] > h->file_size))
+        return "invalid section offset";
+    return nullptr;
+  };
+
+  //
+  // メンバ変数
+  //
+
+  int nthreads_;
+  bool morton_;                   // バッチ探索のクエリを Morton 順にする
+  bool keep_points_;              // 構築するときに元の点を持つか
+  int n_;                         // 点の数
+  int leaves_;                    // 葉の数 (2 のべき乗)
+  bool has_points_;               // 元の点を持っているか
+
+  // 探索はポインタで配列を参照する (構築した木では下の *_buf_，読み込んだ木ではマップしたファイル)
+  const Point* points_;           // 点 (元の順)
+  const int* leaf_begin_;         // 葉 j の点は並べ替えた点列の [leaf_begin_[j], leaf_begin_[j + 1])
+  const double* split_;           // 内部ノードの分割値
+  const uint8_t* axis_;           // 内部ノードの分割軸
+  const int* index_;              // [葉][B] の点のインデックス
+  const Stored* coord_;           // [葉][軸][B] の座標
+  const float* box_;              // [葉][2][軸] の座標の lo, scale (KdQuant16 のとき)
+  const float* error_;            // [葉] の座標の誤差の上限 (T が double でないとき)
+  const Point* leaf_points_;      // [葉][B] の元の点 (T が double でなく元の点を持つとき)
+
+  std::vector<Point> points_buf_;
+  std::vector<int> leaf_begin_buf_;
+  std::vector<double> split_buf_;
+  std::vector<uint8_t> axis_buf_;
+  std::vector<int> index_buf_;
+  std::vector<Stored> coord_buf_;
+  std::vector<float> box_buf_;
+  std::vector<float> error_buf_;
+  std::vector<Point> leaf_points_buf_;
+  std::shared_ptr<MappedFile> file_;  // load() でマップしたファイル
+
+};
+
+#endif // __KDTREEFLAT_HXX__
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////
+//
+// Morton (Z-order) codes and radix sort for point reordering.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef __MORTON_HXX__
+#define __MORTON_HXX__ 1
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "myEigen.hxx"
+
+#include "ParallelFor.hxx"
+
+//
+// N次元の Morton 符号 (64 ビット)
+// - 各軸の座標を Bits = min(32, 64 / N) ビットの整数にして，ビットを軸の順に交互に並べる
+// - BMI2 があれば pdep 命令で，なければ N = 2, 3 はビットを広げるマスクの演算 (1 つの
+//   レジスタの中で並列にビットを動かす) で，それ以外はビットごとに並べる
+//
+template<int N>
+struct Morton {
+
+  enum { Bits = (64 / N < 32) ? 64 / N : 32 };
+
+  static uint64_t encode(const uint32_t* c) {
+    uint64_t code = 0;
+#if defined(__BMI2__)
+    for (int d = 0; d < N; ++d) code |= _pdep_u64(c[d], mask(d));
+#else
+    for (int d = 0; d < N; ++d) code |= spread(c[d]) << d;
+#endif
+    return code;
+  };
+
+private:
+
+#if defined(__BMI2__)
+  // 軸 d のビットの位置 d, d + N, d + 2N, ...
+  static uint64_t mask(int d) {
+    uint64_t m = 0;
+    for (int b = 0; b < Bits; ++b) m |= (uint64_t)1 << (b * N + d);
+    return m;
+  };
+#else
+  // x の下位 Bits ビットを N ビットおきに広げる
+  static uint64_t spread(uint64_t x) {
+    if (N == 2) {
+      x &= 0xffffffffull;
+      x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+      x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+      x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+      x = (x | (x << 2)) & 0x3333333333333333ull;
+      x = (x | (x << 1)) & 0x5555555555555555ull;
+      return x;
+    } else if (N == 3) {
+      x &= 0x1fffffull;
+      x = (x | (x << 32)) & 0x001f00000000ffffull;
+      x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+      x = (x | (x << 8)) & 0x100f00f00f00f00full;
+      x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+      x = (x | (x << 2)) & 0x1249249249249249ull;
+      return x;
+    }
+    uint64_t y = 0;
+    for (int b = 0; b < Bits; ++b) y |= ((x >> b) & 1) << (b * N);
+    return y;
+  };
+#endif
+
+};
+
+// 点列 points[0, n) の Morton 符号を codes に求める (点列のバウンディングボックスで量子化する)
+template<int N>
+void mortonCodes(const Eigen::Vector<double,N>* points, int n, std::vector<uint64_t>& codes,
+                 int nthreads = 1) {
+  codes.resize(n);
+  if (n == 0) return;
+  Eigen::Vector<double,N> mn = points[0], mx = points[0];
+  for (int i = 1; i < n; ++i) {
+    mn = mn.cwiseMin(points[i]);
+    mx = mx.cwiseMax(points[i]);
+  }
+  const double cells = (double)(((uint64_t)1 << Morton<N>::Bits) - 1);
+  Eigen::Vector<double,N> scale;
+  for (int d = 0; d < N; ++d) scale[d] = (mx[d] > mn[d]) ? cells / (mx[d] - mn[d]) : 0.0;
+  parallelFor(n, nthreads, [&](int begin, int end) {
+    uint32_t c[N];
+    for (int i = begin; i < end; ++i) {
+      for (int d = 0; d < N; ++d) c[d] = (uint32_t)((points[i][d] - mn[d]) * scale[d]);
+      codes[i] = Morton<N>::encode(c);
+    }
+  });
+}
+
+// codes の昇順に並べる (LSD radix sort, 11 ビットずつ)．
+// order[i] は i 番目の要素の元の位置で，codes も並べ替える．
+// bits は符号の有効なビット数 (上のビットがすべて 0 の桁は飛ばす)
+inline void radixSort(std::vector<uint64_t>& codes, std::vector<int>& order, int bits = 64) {
+  enum { Digit = 11, Buckets = 1 << Digit };
+  const int n = (int)codes.size();
+  order.resize(n);
+  for (int i = 0; i < n; ++i) order[i] = i;
+  std::vector<uint64_t> tcodes(n);
+  std::vector<int> torder(n);
+  std::vector<int> count(Buckets);
+  for (int shift = 0; shift < bits; shift += Digit) {
+    std::fill(count.begin(), count.end(), 0);
+    for (int i = 0; i < n; ++i) ++count[(codes[i] >> shift) & (Buckets - 1)];
+    // すべて同じ桁なら並べ替えは要らない
+    if (std::find(count.begin(), count.end(), n) != count.end()) continue;
+    for (int b = 0, s = 0; b < Buckets; ++b) {
+      const int c = count[b];
+      count[b] = s;
+      s += c;
+    }
+    for (int i = 0; i < n; ++i) {
+      const int p = count[(codes[i] >> shift) & (Buckets - 1)]++;
+      tcodes[p] = codes[i];
+      torder[p] = order[i];
+    }
+    codes.swap(tcodes);
+    order.swap(torder);
+  }
+}
+
+// 点列 points[0, n) の Morton 順: order[i] は Morton 順で i 番目の点の元のインデックス
+template<int N>
+void mortonOrder(const Eigen::Vector<double,N>* points, int n, std::vector<int>& order,
+                 int nthreads = 1) {
+  std::vector<uint64_t> codes;
+  mortonCodes<N>(points, n, codes, nthreads);
+  radixSort(codes, order, N * Morton<N>::Bits);
+}
+template<int N>
+void mortonOrder(const std::vector<Eigen::Vector<double,N> >& points, std::vector<int>& order,
+                 int nthreads = 1) {
+  mortonOrder<N>(points.data(), (int)points.size(), order, nthreads);
+}
+
+#endif // __MORTON_HXX__
@@ -0,0 +1,503 @@
+////////////////////////////////////////////////////////////////////
+//
+// Error-driven adaptive Loop subdivision with red-green closure.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _LOOPADAPTIVE_HXX
+#define _LOOPADAPTIVE_HXX 1
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "mydef.h"
+#include "myEigen.hxx"
+
+#include "FlatMesh.hxx"
+#include "LoopLimit.hxx"
+#include "LoopSubFlat.hxx"
+
+// LoopAdaptive は，Loop 細分割曲面を誤差が許容値 tolerance 以下になるまで
+// 必要な場所だけ細分割した三角形メッシュを作る．
+//
+// 元の面ごとに 4-to-1 分割 (red) の木を作る．レベル l の三角形の位置は，
+// 分割する三角形とその頂点の 1-ring の面だけを取り出した作業メッシュを
+// LoopSubFlat で 1 回細分割して求める (分割する三角形の子の頂点はステンシルが
+// 作業メッシュの中に収まるので，一様な細分割と同じ位置になる)．
+// 出力の頂点は，現れたレベルの 1-ring に極限点と接ベクトルのマスク
+// (LoopLimitScheme) を掛けた極限点で，極限法線も同時に求めておく．
+// 三角形の誤差は，各エッジについて長さ L と両端の法線の角度 theta から
+// 見積もった弦と曲面の距離 L theta / 8 の最大値とし，これが tolerance を
+// 超える三角形を分割する．
+//
+// 隣り合う三角形のレベル差は 1 以下に揃え (分割されたエッジを 2 本以上持つ
+// 三角形や，分割されたエッジの半分がさらに分割されている三角形は red 分割する)，
+// 分割されたエッジを 1 本だけ持つ三角形は，そのエッジの中点と対頂点を
+// 結んで 2 つに分ける (green 分割)．これで T 字の接続のない出力になる．
+// 木の三角形は同じレベルのエッジの向こうの三角形を持つので，エッジの中点は
+// 隣の三角形の子から引く．
+//
+// 揃えるために分割を足したときは，作業メッシュを作り直すために位置の計算を
+// もう 1 度行う．
+class LoopAdaptive {
+ public:
+  enum { MaxLevel = 20 };
+
+  LoopAdaptive() : tolerance_(1.0e-3), max_level_(8), levels_(0){};
+  ~LoopAdaptive(){};
+
+  // 極限曲面からの許容誤差 (距離)
+  void setTolerance(double tol) { tolerance_ = tol; };
+  double tolerance() const { return tolerance_; };
+
+  // 分割の最大レベル (MaxLevel 以下)
+  void setMaxLevel(int l) { max_level_ = std::max(0, std::min(l, (int)MaxLevel)); };
+  int maxLevel() const { return max_level_; };
+
+  // mesh を適応的に細分割して out に格納する
+  bool apply(const FlatMesh& mesh, FlatMesh& out) {
+    clear();
+    if (mesh.face_size() != TRIANGLE) {
+      std::cerr << "Error: A non-triangle face is included. " << std::endl;
+      return false;
+    }
+
+    // レベル 0 の木は元の面
+    FlatTopology topo;
+    topo.build(mesh);
+    nodes_.resize(mesh.faces_size());
+    for (int f = 0; f < mesh.faces_size(); ++f) {
+      Node& t = nodes_[f];
+      t.face = f;
+      for (int k = 0; k < 3; ++k) {
+        const int m = topo.mate(3 * f + k);
+        t.nb[k] = (m >= 0) ? m / 3 : -1;
+      }
+    }
+
+    // 誤差による分割
+    refine(mesh, true);
+
+    // 隣とのレベル差を 1 以下にする
+    std::vector<int> work;
+    for (int i = 0; i < (int)nodes_.size(); ++i)
+      if (nodes_[i].child < 0) work.push_back(i);
+    bool changed = false;
+    while (!work.empty()) {
+      const int i = work.back();
+      work.pop_back();
+      if ((nodes_[i].child >= 0) || (nodes_[i].level >= max_level_) || !needSplit(i)) continue;
+      split(i);
+      changed = true;
+      // 分割されたエッジの数や深さが変わる三角形を調べ直す
+      const int c = nodes_[i].child;
+      for (int j = 0; j < 4; ++j) work.push_back(c + j);
+      for (int k = 0; k < 3; ++k)
+        if (nodes_[i].nb[k] >= 0) work.push_back(nodes_[i].nb[k]);
+      const int p = nodes_[i].parent;
+      if (p >= 0)
+        for (int k = 0; k < 3; ++k)
+          if (nodes_[p].nb[k] >= 0) work.push_back(nodes_[p].nb[k]);
+    }
+    if (changed) {
+      points_.clear();
+      normals_.clear();
+      refine(mesh, false);
+    }
+
+    // 出力 (分割されたエッジを 1 本持つ三角形は green 分割)
+    std::vector<int> faces;
+    faces.reserve(nodes_.size() * 3);
+    for (const Node& t : nodes_) {
+      if (t.child >= 0) continue;
+      levels_ = std::max(levels_, t.level);
+      int ks = -1;
+      for (int k = 0; k < 3 && ks < 0; ++k)
+        if (t.mid[k] >= 0) ks = k;
+      if (ks < 0) {
+        faces.insert(faces.end(), {t.v[0], t.v[1], t.v[2]});
+        continue;
+      }
+      const int a = t.v[ks], b = t.v[(ks + 1) % 3], c = t.v[(ks + 2) % 3], m = t.mid[ks];
+      faces.insert(faces.end(), {a, m, c});
+      faces.insert(faces.end(), {m, b, c});
+    }
+
+    out.resize((int)points_.size(), (int)faces.size() / TRIANGLE, TRIANGLE);
+    std::copy(faces.begin(), faces.end(), out.faces().begin());
+    for (int i = 0; i < (int)points_.size(); ++i) out.setPoint(i, points_[i]);
+    return true;
+  };
+
+  void clear() {
+    nodes_.clear();
+    points_.clear();
+    normals_.clear();
+    levels_ = 0;
+  };
+
+  // 出力で使われた最大の分割レベル
+  int levels() const { return levels_; };
+
+  // 出力の頂点の極限法線
+  const std::vector<Eigen::Vector3d>& normals() const { return normals_; };
+
+ private:
+  // 木の三角形
+  // - face : そのレベルの作業メッシュの面 (角の並びは LoopSubFlat::setSplit() と同じ)
+  // - child: 子 4 つの先頭 (葉は -1)
+  // - nb   : 同じレベルでエッジ k (角 k -> 角 k + 1) の向こうの三角形 (なければ -1)
+  // - v    : 角の出力の頂点番号
+  // - mid  : 葉のエッジ k が隣で分割されているときの中点の出力の頂点番号 (なければ -1)
+  struct Node {
+    Node() : level(0), face(-1), parent(-1), child(-1) {
+      for (int k = 0; k < 3; ++k) nb[k] = v[k] = mid[k] = -1;
+    };
+    int level;
+    int face;
+    int parent;
+    int child;
+    int nb[3];
+    int v[3];
+    int mid[3];
+  };
+
+  // 三角形 t の隣 g へのエッジの番号
+  int facing(int t, int g) const {
+    for (int k = 0; k < 3; ++k)
+      if (nodes_[t].nb[k] == g) return k;
+    return -1;
+  };
+
+  // 葉 t を red 分割する必要があるか: 分割されたエッジが 2 本以上あるか，
+  // 分割されたエッジの半分がさらに分割されている
+  bool needSplit(int t) const {
+    int nsplit = 0;
+    for (int k = 0; k < 3; ++k) {
+      const int g = nodes_[t].nb[k];
+      if ((g < 0) || (nodes_[g].child < 0)) continue;
+      if (++nsplit >= 2) return true;
+      const int j = facing(g, t), c = nodes_[g].child;
+      if ((j >= 0) && ((nodes_[c + j].child >= 0) || (nodes_[c + (j + 1) % 3].child >= 0)))
+        return true;
+    }
+    return false;
+  };
+
+  // 三角形 t の子を作り，同じレベルの隣をつなぐ．
+  // 子 k のエッジ 0 は t のエッジ k の前半，子 k + 1 のエッジ 2 は後半である
+  void split(int t) {
+    const int c = (int)nodes_.size();
+    nodes_.resize(c + 4);
+    nodes_[t].child = c;
+    for (int j = 0; j < 4; ++j) {
+      nodes_[c + j].level = nodes_[t].level + 1;
+      nodes_[c + j].parent = t;
+    }
+    for (int k = 0; k < 3; ++k) {
+      nodes_[c + k].nb[1] = c + 3;
+      nodes_[c + 3].nb[(k + 2) % 3] = c + k;
+    }
+    for (int k = 0; k < 3; ++k) {
+      const int g = nodes_[t].nb[k];
+      if ((g < 0) || (nodes_[g].child < 0)) continue;
+      const int j = facing(g, t), gc = nodes_[g].child;
+      if (j < 0) continue;
+      nodes_[c + k].nb[0] = gc + (j + 1) % 3;
+      nodes_[gc + (j + 1) % 3].nb[2] = c + k;
+      nodes_[c + (k + 1) % 3].nb[2] = gc + j;
+      nodes_[gc + j].nb[0] = c + (k + 1) % 3;
+    }
+  };
+
+  // 木をレベルごとにたどり，三角形の位置と出力の頂点を求める．
+  // 分割する三角形の頂点の 1-ring の面を作業メッシュとして LoopSubFlat で init() し，
+  // 子の三角形とその頂点の 1-ring の頂点の位置をステンシルで求める．
+  // test のときは誤差が tolerance を超える葉を分割する
+  void refine(const FlatMesh& mesh, bool test) {
+    // level: そのレベルの三角形, vid: sub の頂点 -> 出力の頂点
+    std::vector<int> level(mesh.faces_size()), next;
+    for (int f = 0; f < mesh.faces_size(); ++f) level[f] = f;
+    std::vector<int> vid(mesh.vertices_size(), -1), fvid;
+    std::vector<int> wface, wvert, wmap, fine_faces, fine_verts, fmap;
+    std::vector<char> mark, need, split_face;
+    FlatMesh fine[2], work;
+    const FlatMesh* sub = &mesh;
+    LoopSubFlat kernel;
+
+    // 元の頂点の極限点
+    if (kernel.init(mesh) == false) return;
+    for (int f = 0; f < mesh.faces_size(); ++f)
+      for (int k = 0; k < 3; ++k) {
+        const int v = mesh.face(f)[k];
+        if (vid[v] < 0) vid[v] = addLimit(mesh, kernel.topology(), v);
+      }
+
+    for (int l = 0;; ++l) {
+      for (int t : level) {
+        Node& n = nodes_[t];
+        const int* fv = sub->face(n.face);
+        for (int k = 0; k < 3; ++k) {
+          n.v[k] = vid[fv[k]];
+          n.mid[k] = -1;
+        }
+      }
+
+      // 分割された三角形の隣の葉に，エッジの中点 (子 k の角 1) を知らせる
+      for (int i = 0; (l > 0) && (i < (int)level.size()); i += 4) {
+        const int t = nodes_[level[i]].parent;
+        for (int k = 0; k < 3; ++k) {
+          const int g = nodes_[t].nb[k], j = (g >= 0) ? facing(g, t) : -1;
+          if ((j >= 0) && (nodes_[g].child < 0)) nodes_[g].mid[j] = nodes_[level[i] + k].v[1];
+        }
+      }
+
+      if (test) {
+        nodes_.reserve(nodes_.size() + 4 * level.size());
+        for (int t : level)
+          if ((l < max_level_) && exceeds(nodes_[t])) split(t);
+      }
+      next.clear();
+      for (int t : level)
+        if (nodes_[t].child >= 0)
+          for (int j = 0; j < 4; ++j) next.push_back(nodes_[t].child + j);
+      if (next.empty()) break;
+
+      // 分割する三角形の頂点 (mark) の 1-ring の面を作業メッシュにする
+      // (レベル 0 は元のメッシュのまま)
+      mark.assign(sub->vertices_size(), 0);
+      split_face.assign(sub->faces_size(), 0);
+      for (int t : level)
+        if (nodes_[t].child >= 0) {
+          split_face[nodes_[t].face] = 1;
+          for (int k = 0; k < 3; ++k) mark[sub->face(nodes_[t].face)[k]] = 1;
+        }
+      wface.clear();
+      wvert.clear();
+      if (l == 0) {
+        for (int f = 0; f < mesh.faces_size(); ++f) wface.push_back(f);
+        for (int v = 0; v < mesh.vertices_size(); ++v) wvert.push_back(v);
+      } else {
+        wmap.assign(sub->vertices_size(), -1);
+        for (int f = 0; f < sub->faces_size(); ++f) {
+          const int* fv = sub->face(f);
+          if ((mark[fv[0]] | mark[fv[1]] | mark[fv[2]]) == 0) continue;
+          wface.push_back(f);
+          for (int k = 0; k < 3; ++k)
+            if (wmap[fv[k]] < 0) {
+              wmap[fv[k]] = (int)wvert.size();
+              wvert.push_back(fv[k]);
+            }
+        }
+        work.resize((int)wvert.size(), (int)wface.size(), TRIANGLE);
+        for (int d = 0; d < 3; ++d) {
+          const double* x = sub->coord(d);
+          double* wx = work.coord(d);
+          for (int i = 0; i < (int)wvert.size(); ++i) wx[i] = x[wvert[i]];
+        }
+        int* wf = work.faces().data();
+        for (int i = 0; i < (int)wface.size(); ++i)
+          for (int k = 0; k < 3; ++k) wf[3 * i + k] = wmap[sub->face(wface[i])[k]];
+        if (kernel.init(work) == false) return;
+      }
+      const FlatMesh& w = (l == 0) ? mesh : work;
+      const FlatTopology& topo = kernel.topology();
+
+      // 細分割後の頂点 (even: v, odd: nv + エッジ) のうち，次のレベルの三角形の頂点
+      // (分割する三角形の角とエッジ) に印を付ける．作業メッシュの面の子のうち，印の付いた頂点を持つものが次のレベルの
+      // メッシュになる (次のレベルの三角形の頂点の 1-ring を含む)
+      const int nv = w.vertices_size();
+      need.assign(kernel.subVertices_size(), 0);
+      for (int i = 0; i < (int)wface.size(); ++i) {
+        const int h = 3 * i;
+        if (split_face[wface[i]] == 0) continue;
+        for (int k = 0; k < 3; ++k) {
+          need[topo.origin(h + k)] = 1;
+          need[nv + topo.edge(h + k)] = 1;
+        }
+      }
+      static const int child[4][3] = {{0, 3, 5}, {1, 4, 3}, {2, 5, 4}, {3, 4, 5}};
+      fmap.assign((size_t)4 * sub->faces_size(), -1);
+      fine_faces.clear();
+      fine_verts.assign(kernel.subVertices_size(), -1);
+      int nfv = 0;
+      for (int i = 0; i < (int)wface.size(); ++i) {
+        const int h = 3 * i;
+        const int c[6] = {topo.origin(h), topo.origin(h + 1), topo.origin(h + 2),
+                          nv + topo.edge(h), nv + topo.edge(h + 1), nv + topo.edge(h + 2)};
+        for (int j = 0; j < 4; ++j) {
+          const int* cj = child[j];
+          if ((need[c[cj[0]]] | need[c[cj[1]]] | need[c[cj[2]]]) == 0) continue;
+          fmap[4 * wface[i] + j] = (int)fine_faces.size() / 3;
+          for (int k = 0; k < 3; ++k) {
+            int& fv = fine_verts[c[cj[k]]];
+            if (fv < 0) fv = nfv++;
+            fine_faces.push_back(fv);
+          }
+        }
+      }
+
+      // 次のレベルのメッシュの頂点の位置は LoopSubFlat のステンシルで求める．
+      // even vertex は出力の頂点を引き継ぐ
+      FlatMesh& f1 = fine[l & 1];
+      f1.resize(nfv, (int)fine_faces.size() / 3, TRIANGLE);
+      std::copy(fine_faces.begin(), fine_faces.end(), f1.faces().begin());
+      const double* x = w.coord(0);
+      const double* y = w.coord(1);
+      const double* z = w.coord(2);
+      double* fx = f1.coord(0);
+      double* fy = f1.coord(1);
+      double* fz = f1.coord(2);
+      fvid.assign(nfv, -1);
+      for (int i = 0; i < kernel.subVertices_size(); ++i) {
+        const int fv = fine_verts[i];
+        if (fv < 0) continue;
+        double px = 0.0, py = 0.0, pz = 0.0;
+        kernel.stencil(i, [&](int c, double wt) {
+          px += wt * x[c];
+          py += wt * y[c];
+          pz += wt * z[c];
+        });
+        fx[fv] = px; fy[fv] = py; fz[fv] = pz;
+        if (i < nv) fvid[fv] = vid[wvert[i]];
+      }
+
+      // 新しい頂点 (分割するエッジの odd vertex) の極限点
+      for (int i = 0; i < (int)wface.size(); ++i)
+        for (int k = 0; k < 3; ++k) {
+          const int h = 3 * i + k, o = fine_verts[nv + topo.edge(h)];
+          if ((o >= 0) && (need[nv + topo.edge(h)] != 0) && (fvid[o] < 0))
+            fvid[o] = addOddLimit(f1, topo, nv, fine_verts, h);
+        }
+
+      for (int t : level) {
+        const int c = nodes_[t].child;
+        if (c < 0) continue;
+        for (int j = 0; j < 4; ++j) nodes_[c + j].face = fmap[4 * nodes_[t].face + j];
+      }
+      sub = &f1;
+      vid.swap(fvid);
+      level.swap(next);
+    }
+  };
+
+  // 作業メッシュ sub の頂点 v の極限点と極限法線を出力の頂点に加える
+  int addLimit(const FlatMesh& sub, const FlatTopology& topo, int v) {
+    const double* x = sub.coord(0);
+    const double* y = sub.coord(1);
+    const double* z = sub.coord(2);
+    Eigen::Vector3d p = Eigen::Vector3d::Zero();
+    Eigen::Vector3d t1 = Eigen::Vector3d::Zero(), t2 = Eigen::Vector3d::Zero();
+    LoopLimitScheme::limitStencil(topo, v, [&](int c, double w) {
+      p += w * Eigen::Vector3d(x[c], y[c], z[c]);
+    });
+    LoopLimitScheme::tangentStencils(
+        topo, v, [&](int c, double w) { t1 += w * Eigen::Vector3d(x[c], y[c], z[c]); },
+        [&](int c, double w) { t2 += w * Eigen::Vector3d(x[c], y[c], z[c]); });
+    return addPoint(p, t1.cross(t2));
+  };
+
+  int addPoint(const Eigen::Vector3d& p, Eigen::Vector3d n) {
+    if (n.norm() > 0.0) n.normalize();
+    points_.push_back(p);
+    normals_.push_back(n);
+    return (int)points_.size() - 1;
+  };
+
+  // 作業メッシュ (位相 topo, 頂点数 nv) のハーフエッジ h の odd vertex の極限点と
+  // 極限法線を出力の頂点に加える．odd vertex の 1-ring は h の両側の面の子で決まり
+  // (内部は valence 6，境界は境界の valence 4)，次のレベルのメッシュ fine の頂点で
+  // 反時計回りに
+  //   dest(h), (h + 1 の odd), (h + 2 の odd), origin(h), (mate の面の同じ並び)
+  // である．マスクは同じ 1-ring を持つ小さなメッシュで LoopLimitScheme から求めておく
+  int addOddLimit(const FlatMesh& fine, const FlatTopology& topo, int nv,
+                  const std::vector<int>& fine_verts, int h) {
+    if (ring_[0].lim.empty()) setRingMasks();
+    const int m = topo.mate(h);
+    const RingMask& mask = ring_[(m < 0) ? 1 : 0];
+    int r[7];
+    r[0] = fine_verts[nv + topo.edge(h)];
+    r[1] = fine_verts[topo.dest(h)];
+    r[2] = fine_verts[nv + topo.edge(topo.next(h))];
+    r[3] = fine_verts[nv + topo.edge(topo.prev(h))];
+    r[4] = fine_verts[topo.origin(h)];
+    if (m >= 0) {
+      r[5] = fine_verts[nv + topo.edge(topo.next(m))];
+      r[6] = fine_verts[nv + topo.edge(topo.prev(m))];
+    }
+    const double* x = fine.coord(0);
+    const double* y = fine.coord(1);
+    const double* z = fine.coord(2);
+    Eigen::Vector3d p = Eigen::Vector3d::Zero();
+    Eigen::Vector3d t1 = Eigen::Vector3d::Zero(), t2 = Eigen::Vector3d::Zero();
+    for (int i = 0; i < (int)mask.lim.size(); ++i) {
+      const Eigen::Vector3d q(x[r[i]], y[r[i]], z[r[i]]);
+      p += mask.lim[i] * q;
+      t1 += mask.t1[i] * q;
+      t2 += mask.t2[i] * q;
+    }
+    return addPoint(p, t1.cross(t2));
+  };
+
+  // 1-ring (中心 0，まわりの頂点 1, 2, ... を反時計回り) の極限点と接ベクトルのマスク
+  // ring_[0]: 内部の valence 6, ring_[1]: 境界の valence 4
+  struct RingMask {
+    std::vector<double> lim, t1, t2;
+  };
+
+  void setRingMasks() {
+    for (int b = 0; b < 2; ++b) {
+      const int n = (b == 0) ? 6 : 3;  // 面の数
+      FlatMesh fan;
+      fan.resize(n + ((b == 0) ? 1 : 2), n, TRIANGLE);
+      for (int i = 0; i < n; ++i) {
+        int* fv = fan.faces().data() + 3 * i;
+        fv[0] = 0;
+        fv[1] = 1 + i;
+        fv[2] = (b == 0) ? 1 + (i + 1) % n : 2 + i;
+      }
+      FlatTopology topo;
+      topo.build(fan);
+      RingMask& mask = ring_[b];
+      mask.lim.assign(fan.vertices_size(), 0.0);
+      mask.t1.assign(fan.vertices_size(), 0.0);
+      mask.t2.assign(fan.vertices_size(), 0.0);
+      LoopLimitScheme::limitStencil(topo, 0, [&](int c, double w) { mask.lim[c] += w; });
+      LoopLimitScheme::tangentStencils(topo, 0, [&](int c, double w) { mask.t1[c] += w; },
+                                       [&](int c, double w) { mask.t2[c] += w; });
+    }
+  };
+
+  // 弦と曲面の距離の見積もり max (エッジの長さ L x 両端の法線の角度 theta / 8) が
+  // tolerance を超えるか．theta と法線の差の長さ d には d <= theta <= pi d / 2 の
+  // 関係があるので，L d で決まらないエッジだけ acos を求める
+  bool exceeds(const Node& t) const {
+    const double tol2 = 64.0 * tolerance_ * tolerance_;
+    for (int k = 0; k < 3; ++k) {
+      const int a = t.v[k], b = t.v[(k + 1) % 3];
+      const double l2 = (points_[a] - points_[b]).squaredNorm();
+      const double ld2 = l2 * (normals_[a] - normals_[b]).squaredNorm();
+      if (ld2 > tol2) return true;
+      if (ld2 * (M_PI * M_PI / 4.0) <= tol2) continue;
+      const double c = std::max(-1.0, std::min(1.0, normals_[a].dot(normals_[b])));
+      if (std::sqrt(l2) * std::acos(c) > 8.0 * tolerance_) return true;
+    }
+    return false;
+  };
+
+  double tolerance_;
+  int max_level_;
+  int levels_;
+
+  std::vector<Node> nodes_;  // 細分割の木 (元の面が先頭)
+  RingMask ring_[2];
+  std::vector<Eigen::Vector3d> points_;
+  std::vector<Eigen::Vector3d> normals_;
+};
+
+#endif  // _LOOPADAPTIVE_HXX
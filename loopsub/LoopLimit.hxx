@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////
+//
+// Loop subdivision limit-surface evaluation.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _LOOPLIMIT_HXX
+#define _LOOPLIMIT_HXX 1
+
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "mydef.h"
+
+#include "FlatMesh.hxx"
+#include "LimitEvaluator.hxx"
+#include "LoopMask.hxx"
+#include "LoopSubFlat.hxx"
+
+// LimitEvaluator に渡す Loop 細分割の定義
+//
+// 面パラメータ (u, v) は重心座標 (1 - u - v, u, v) であり，
+// 角 0 から角 1 への方向が u，角 0 から角 2 への方向が v である．
+struct LoopLimitScheme {
+  typedef LoopSubFlat Kernel;
+  enum { FaceSize = 3, RegularValence = 6 };
+
+  static const char* name() { return "Loop"; };
+
+  // 正則パッチ (box spline) は 4 次多項式
+  static void monomials(std::vector<std::pair<int, int> >& m) {
+    m.clear();
+    for (int d = 0; d <= 4; ++d)
+      for (int a = d; a >= 0; --a) m.emplace_back(a, d - a);
+  };
+
+  // 2 回細分割した格子点 (i / 4, j / 4)
+  static void samples(std::vector<std::pair<double, double> >& st) {
+    st.clear();
+    for (int i = 0; i <= 4; ++i)
+      for (int j = 0; i + j <= 4; ++j) st.emplace_back(i / 4.0, j / 4.0);
+  };
+
+  // 角 k を角 0 とするパラメータ
+  static void rotate(int k, double u, double v, double* s, double* t) {
+    const double b[3] = {1.0 - u - v, u, v};
+    *s = b[(k + 1) % 3];
+    *t = b[(k + 2) % 3];
+  };
+
+  // (u, v) を含む子の面 (LoopSubFlat::setSplit() の順) と，子の面のパラメータ
+  //   0: (v0, o0, o2), 1: (v1, o1, o0), 2: (v2, o2, o1), 3: (o0, o1, o2)
+  static int child(double u, double v, double* s, double* t) {
+    if (u + v < 0.5) {
+      *s = 2.0 * u;
+      *t = 2.0 * v;
+      return 0;
+    }
+    if (u >= 0.5) {
+      *s = 2.0 * v;
+      *t = 2.0 - 2.0 * u - 2.0 * v;
+      return 1;
+    }
+    if (v >= 0.5) {
+      *s = 2.0 - 2.0 * u - 2.0 * v;
+      *t = 2.0 * u;
+      return 2;
+    }
+    *s = 2.0 * u + 2.0 * v - 1.0;
+    *t = 1.0 - 2.0 * u;
+    return 3;
+  };
+
+  // 頂点 v の極限点のマスク
+  //   内部:   (1 - n chi) v + chi sum v_i,  chi = 1 / (n + 3 / (8 beta))
+  //   境界:   (v_a + 4 v + v_b) / 6 (3 次 B-spline 曲線)
+  template <class F>
+  static void limitStencil(const FlatTopology& topo, int v, F&& f) {
+    if (topo.isBoundary(v)) {
+      int a, b;
+      if (topo.boundaryNeighbors(v, &a, &b) == false) {
+        f(v, 1.0);
+        return;
+      }
+      f(v, 4.0 / 6.0);
+      f(a, 1.0 / 6.0);
+      f(b, 1.0 / 6.0);
+      return;
+    }
+    const int n = topo.outDegree(v);
+    if (n < 3) {
+      f(v, 1.0);
+      return;
+    }
+    const double chi = 1.0 / (n + LOOP_MASK_38 / loopBeta(n));
+    f(v, 1.0 - n * chi);
+    for (const int* it = topo.voutBegin(v); it != topo.voutEnd(v); ++it)
+      f(topo.dest(*it), chi);
+  };
+
+  // 頂点 v の 2 つの接ベクトルのマスク (法線は t1 x t2)
+  //   内部: 反時計回りの 1-ring に cos(2 pi i / n), sin(2 pi i / n)
+  //   境界: t1 は境界を横切る方向 (Hoppe et al. 1994)，t2 は境界に沿う方向
+  template <class F, class G>
+  static void tangentStencils(const FlatTopology& topo, int v, F&& f1, G&& f2) {
+    const int n = topo.outDegree(v);
+    int h = topo.firstOut(v);
+    if (h < 0) return;
+
+    if (topo.isBoundary(v) == false) {
+      // cos, sin は角度 2 pi / n の回転を繰り返して求める
+      const double cn = std::cos(2.0 * M_PI / n), sn = std::sin(2.0 * M_PI / n);
+      double c = 1.0, s = 0.0;
+      for (int i = 0; i < n && h >= 0; ++i, h = topo.ccwOut(h)) {
+        f1(topo.dest(h), c);
+        f2(topo.dest(h), s);
+        const double t = c * cn - s * sn;
+        s = s * cn + c * sn;
+        c = t;
+      }
+      return;
+    }
+
+    // 境界頂点の 1-ring: v_0 (= a), v_1, ..., v_k (= b)
+    std::vector<int> ring;
+    for (; h >= 0; h = topo.ccwOut(h)) {
+      ring.push_back(topo.dest(h));
+      if (topo.ccwOut(h) < 0) ring.push_back(topo.origin(topo.prev(h)));
+    }
+    const int k = (int)ring.size() - 1;
+    if (k < 1) return;
+    if (k == 1) {
+      f1(v, 2.0);
+      f1(ring[0], -1.0);
+      f1(ring[1], -1.0);
+    } else {
+      const double theta = M_PI / k;
+      f1(ring[0], std::sin(theta));
+      f1(ring[k], std::sin(theta));
+      for (int i = 1; i < k; ++i)
+        f1(ring[i], (2.0 * std::cos(theta) - 2.0) * std::sin(i * theta));
+    }
+    f2(ring[0], 1.0);
+    f2(ring[k], -1.0);
+  };
+};
+
+typedef LimitEvaluator<LoopLimitScheme> LoopLimit;
+
+#endif  // _LOOPLIMIT_HXX
@@ -0,0 +1,50 @@
+////////////////////////////////////////////////////////////////////
+//
+// Loop subdivision masks.
+//
+// Copyright (c) 2022-2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _LOOPMASK_HXX
+#define _LOOPMASK_HXX 1
+
+#include <cmath>
+
+// masks
+#define LOOP_MASK_BETA3 0.1875
+#define LOOP_MASK_12 0.5
+#define LOOP_MASK_18 0.125
+#define LOOP_MASK_38 0.375
+#define LOOP_MASK_58 0.625
+#define LOOP_MASK_68 0.75
+
+// Loop beta for valence = 4 ... 10
+static double loop_beta[7] = {
+  0.121094,
+  0.0840932,
+  0.0625,
+  0.0490249,
+  0.0400678,
+  0.033785,
+  0.0291778
+};
+
+// 表にない valence の beta (Loop の式で計算する)
+inline double loopCalcBeta(int valence) {
+  double dval = (double)valence;
+  double d = LOOP_MASK_38 + std::cos(2.0 * M_PI / dval) / 4.0;
+  return (LOOP_MASK_58 - d * d) / dval;
+}
+
+// valence ごとの beta
+inline double loopBeta(int valence) {
+  if (valence == 3)
+    return LOOP_MASK_BETA3;
+  else if ((valence >= 4) && (valence <= 10))
+    return loop_beta[valence - 4];
+  return loopCalcBeta(valence);
+}
+
+#endif  // _LOOPMASK_HXX
@@ -0,0 +1,207 @@
+////////////////////////////////////////////////////////////////////
+//
+// Index-based Loop subdivision kernel on FlatMesh.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _LOOPSUBFLAT_HXX
+#define _LOOPSUBFLAT_HXX 1
+
+#include <iostream>
+#include <vector>
+
+#include "mydef.h"
+#include "myEigen.hxx"
+
+#include "FlatArena.hxx"
+#include "FlatMesh.hxx"
+#include "LoopMask.hxx"
+
+// LoopSubFlat は LoopSub と同じ Loop 細分割を FlatMesh 上で行う．
+// VertexL などの shared_ptr を一切生成しないため，高いレベルでも
+// 配列の確保のみで細分割できる．
+//
+// 細分割後の頂点の並びは LoopSub と同じく
+//   [0, nv)       : even vertex (元の頂点 v に対応)
+//   [nv, nv + ne) : odd vertex  (元のエッジ e に対応)
+// である．
+//
+// setNumThreads() で 2 以上を指定すると，面・even・odd の各ループを
+// 連続区間に分けて並列に処理する．各出力は直前のレベルだけから
+// 同じ順序で計算されるので，結果はスレッド数によらずビット単位で一致する．
+class LoopSubFlat {
+ public:
+  LoopSubFlat() : nthreads_(1){};
+  ~LoopSubFlat(){};
+
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
+  const FlatTopology& topology() const { return topo_; };
+
+  // mesh を 1 回細分割して submesh に格納する
+  bool apply(const FlatMesh& mesh, FlatMesh& submesh) {
+    if (init(mesh) == false) return false;
+    setSplit(mesh, submesh);
+    setStencil(mesh, submesh);
+    return true;
+  };
+
+  // mesh を levels 回細分割して submesh に格納する．
+  // 途中のレベルは 2 つの FlatArena を交互に使うので，同時に保持するのは
+  // 細分割元と細分割先の 2 レベル分だけである (subdivideLevels())．
+  bool apply(const FlatMesh& mesh, FlatMesh& submesh, int levels) {
+    return subdivideLevels(*this, mesh, submesh, levels, &stats_);
+  };
+
+  // 直前の apply(levels) の途中のレベルごとの配列の使用量
+  const std::vector<FlatLevelStats>& levelStats() const { return stats_; };
+
+  // r は位相の配列を確保するメモリ資源
+  bool init(const FlatMesh& mesh,
+            std::pmr::memory_resource* r = std::pmr::get_default_resource()) {
+    if (mesh.face_size() != TRIANGLE) {
+      std::cerr << "Error: A non-triangle face is included. " << std::endl;
+      return false;
+    }
+    topo_.build(mesh, nthreads_, r);
+
+    // valence ごとの beta をあらかじめ求めておく
+    int max_valence = 0;
+    for (int v = 0; v < topo_.vertices_size(); ++v)
+      if (max_valence < topo_.outDegree(v)) max_valence = topo_.outDegree(v);
+    beta_.resize(max_valence + 1);
+    for (int n = 3; n <= max_valence; ++n) beta_[n] = loopBeta(n);
+
+    return true;
+  };
+
+  // 4-to-1 分割の面を生成する
+  void setSplit(const FlatMesh& mesh, FlatMesh& submesh) {
+    const int nv = mesh.vertices_size();
+    const int nf = mesh.faces_size();
+    submesh.resize(nv + topo_.edges_size(), 4 * nf, TRIANGLE);
+
+    const int* fv = mesh.faces().data();
+    int* sf = submesh.faces().data();
+    parallelFor(nf, nthreads_, [&](int begin, int end) {
+      for (int f = begin; f < end; ++f) {
+        const int h = 3 * f;
+        const int v0 = fv[h], v1 = fv[h + 1], v2 = fv[h + 2];
+        const int o0 = nv + topo_.edge(h);      // v0 - v1
+        const int o1 = nv + topo_.edge(h + 1);  // v1 - v2
+        const int o2 = nv + topo_.edge(h + 2);  // v2 - v0
+
+        int* c = sf + 12 * f;
+        c[0] = v0; c[1] = o0;  c[2] = o2;
+        c[3] = v1; c[4] = o1;  c[5] = o0;
+        c[6] = v2; c[7] = o2;  c[8] = o1;
+        c[9] = o0; c[10] = o1; c[11] = o2;
+      }
+    });
+  };
+
+  // even / odd vertex の位置を計算する
+  void setStencil(const FlatMesh& mesh, FlatMesh& submesh) const {
+    const int nv = mesh.vertices_size();
+    const double* x = mesh.coord(0);
+    const double* y = mesh.coord(1);
+    const double* z = mesh.coord(2);
+    double* sx = submesh.coord(0);
+    double* sy = submesh.coord(1);
+    double* sz = submesh.coord(2);
+
+    // even vertex points
+    parallelFor(nv, nthreads_, [&](int begin, int end) {
+      for (int v = begin; v < end; ++v) {
+        double px = 0.0, py = 0.0, pz = 0.0;
+        evenStencil(v, [&](int c, double w) {
+          px += w * x[c];
+          py += w * y[c];
+          pz += w * z[c];
+        });
+        sx[v] = px; sy[v] = py; sz[v] = pz;
+      }
+    });
+
+    // odd vertex points
+    parallelFor(topo_.edges_size(), nthreads_, [&](int begin, int end) {
+      for (int e = begin; e < end; ++e) {
+        double px = 0.0, py = 0.0, pz = 0.0;
+        oddStencil(e, [&](int c, double w) {
+          px += w * x[c];
+          py += w * y[c];
+          pz += w * z[c];
+        });
+        sx[nv + e] = px; sy[nv + e] = py; sz[nv + e] = pz;
+      }
+    });
+  };
+
+  // 細分割後の頂点数
+  int subVertices_size() const {
+    return topo_.vertices_size() + topo_.edges_size();
+  };
+
+  // 細分割後の頂点 i のステンシル (init() の後に呼ぶ)
+  template <class F>
+  void stencil(int i, F&& f) const {
+    const int nv = topo_.vertices_size();
+    if (i < nv)
+      evenStencil(i, f);
+    else
+      oddStencil(i - nv, f);
+  };
+
+  // even vertex v のステンシル: f(頂点番号, 重み) を重みの数だけ呼ぶ
+  template <class F>
+  void evenStencil(int v, F&& f) const {
+    const int n = topo_.outDegree(v);
+    if (topo_.isBoundary(v)) {
+      int a, b;
+      if (topo_.boundaryNeighbors(v, &a, &b) == false) {
+        f(v, 1.0);
+        return;
+      }
+      f(v, LOOP_MASK_68);
+      f(a, LOOP_MASK_18);
+      f(b, LOOP_MASK_18);
+      return;
+    }
+    if (n < 3) {
+      f(v, 1.0);
+      return;
+    }
+    const double beta = beta_[n];
+    f(v, 1.0 - n * beta);
+    for (const int* it = topo_.voutBegin(v); it != topo_.voutEnd(v); ++it)
+      f(topo_.dest(*it), beta);
+  };
+
+  // odd vertex (エッジ e) のステンシル
+  template <class F>
+  void oddStencil(int e, F&& f) const {
+    const int h = topo_.edgeHalfedge(e);
+    const int m = topo_.mate(h);
+    if (m < 0) {
+      f(topo_.origin(h), LOOP_MASK_12);
+      f(topo_.dest(h), LOOP_MASK_12);
+      return;
+    }
+    f(topo_.origin(h), LOOP_MASK_38);
+    f(topo_.dest(h), LOOP_MASK_38);
+    f(topo_.origin(topo_.prev(h)), LOOP_MASK_18);
+    f(topo_.origin(topo_.prev(m)), LOOP_MASK_18);
+  };
+
+ private:
+  FlatTopology topo_;
+  std::vector<double> beta_;  // valence -> beta
+  std::vector<FlatLevelStats> stats_;
+  int nthreads_;
+};
+
+#endif  // _LOOPSUBFLAT_HXX
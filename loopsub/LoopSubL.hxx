@@ -27,31 +27,21 @@
 #include "VertexLCirculator.hxx"
 #include "MeshUtiL.hxx"
 
-// masks
-#define LOOP_MASK_BETA3 0.1875
-#define LOOP_MASK_12 0.5
-#define LOOP_MASK_18 0.125
-#define LOOP_MASK_38 0.375
-#define LOOP_MASK_58 0.625
-#define LOOP_MASK_68 0.75
-
-// Loop beta for valence = 4 ... 10
-static double loop_beta[7] = {
-  0.121094,
-  0.0840932,
-  0.0625,
-  0.0490249,
-  0.0400678,
-  0.033785,
-  0.0291778
-};
-
+#include "LoopAdaptive.hxx"
+#include "LoopLimit.hxx"
+#include "LoopMask.hxx"
+#include "FlatMeshL.hxx"
+#include "LoopSubFlat.hxx"
+#include "SubdivOperator.hxx"
 
 class LoopSub {
  public:
-  LoopSub() : mesh_(nullptr), submesh_(nullptr){};
-  LoopSub(std::shared_ptr<MeshL> mesh) : submesh_(nullptr) { setMesh(mesh); };
-  LoopSub(std::shared_ptr<MeshL> mesh, std::shared_ptr<MeshL> submesh) {
+  LoopSub() : mesh_(nullptr), submesh_(nullptr), nthreads_(1){};
+  LoopSub(std::shared_ptr<MeshL> mesh) : submesh_(nullptr), nthreads_(1) {
+    setMesh(mesh);
+  };
+  LoopSub(std::shared_ptr<MeshL> mesh, std::shared_ptr<MeshL> submesh)
+      : nthreads_(1) {
     setMesh(mesh);
     setSubMesh(submesh);
   };
@@ -61,6 +51,11 @@ class LoopSub {
   void setSubMesh(std::shared_ptr<MeshL> mesh) { submesh_ = mesh; };
   MeshL& submesh() const { return *submesh_; };
 
+  // 配列上の細分割 (LoopSubFlat など) のスレッド数 (1 のときは逐次処理)．
+  // setStencil() は演習のコードなので逐次処理のままである
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
   bool emptyMesh() const { return (mesh_ != nullptr) ? false : true; };
   bool emptySubMesh() const { return (submesh_ != nullptr) ? false : true; };
 
@@ -74,6 +69,111 @@ class LoopSub {
     clear();
   };
 
+  // levels 回の細分割を一度に行う．
+  // LoopSubFlat により配列上で細分割し，途中のレベルは 2 つのバッファを
+  // 交互に使って計算する．MeshL は最終レベルの submesh だけを構築する．
+  void apply(int levels) {
+    if (emptyMesh()) return;
+    if (emptySubMesh()) return;
+
+    FlatMesh flat, subflat;
+    if (flatFromMeshL(*mesh_, TRIANGLE, flat) == false) return;
+
+    LoopSubFlat loopflat;
+    loopflat.setNumThreads(nthreads_);
+    if (loopflat.apply(flat, subflat, levels) == false) return;
+    flat = FlatMesh();  // MeshL の構築前に入力側の配列を解放する
+
+    flatToMeshL(subflat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    std::cout << "loop subdiv. (level " << levels << "): done. v "
+              << submesh_->vertices_size() << " f " << submesh_->faces_size()
+              << std::endl;
+  };
+
+  // mesh の位相から levels 回分の細分割行列を op に作る．
+  // 位相が変わらない限り，op は applyOperator() で何度でも使える．
+  bool buildOperator(int levels, SubdivOperator& op) {
+    if (emptyMesh()) return false;
+
+    FlatMesh flat;
+    if (flatFromMeshL(*mesh_, TRIANGLE, flat) == false) return false;
+
+    op.setNumThreads(nthreads_);
+    return op.build<LoopSubFlat>(flat, levels);
+  };
+
+  // mesh の現在の頂点位置を op で細分割し，submesh に格納する．
+  // submesh が空のときは面も作り，そうでなければ頂点位置だけを更新する．
+  // op が mesh の頂点数と合わない場合は false を返す．
+  bool applyOperator(const SubdivOperator& op) {
+    if (emptyMesh()) return false;
+    if (emptySubMesh()) return false;
+
+    FlatMesh flat, subflat;
+    flat.resize(mesh_->vertices_size(), 0, TRIANGLE);
+    flatPointsFromMeshL(*mesh_, flat);
+    if (op.apply(flat, subflat) == false) return false;
+
+    if (submesh_->vertices_size() == 0)
+      flatToMeshL(subflat, *submesh_);
+    else
+      flatPointsToMeshL(subflat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    return true;
+  };
+
+  // 極限曲面からの誤差が tolerance 以下になるところまで適応的に
+  // 細分割したメッシュを submesh に作る．
+  bool applyAdaptive(double tolerance, int maxLevel = 8) {
+    if (emptyMesh()) return false;
+    if (emptySubMesh()) return false;
+
+    FlatMesh flat;
+    if (flatFromMeshL(*mesh_, TRIANGLE, flat) == false) return false;
+
+    LoopAdaptive adaptive;
+    adaptive.setTolerance(tolerance);
+    adaptive.setMaxLevel(maxLevel);
+    FlatMesh subflat;
+    if (adaptive.apply(flat, subflat) == false) return false;
+
+    flatToMeshL(subflat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    std::cout << "loop adaptive: done. tol " << tolerance << " max level "
+              << adaptive.levels() << " v " << submesh_->vertices_size()
+              << " f " << submesh_->faces_size() << std::endl;
+    return true;
+  };
+
+  // mesh の極限曲面を評価する limit を用意する．
+  // limit.evaluate(f, u, v) の面番号 f は mesh.faces() の走査順，
+  // 頂点番号は mesh.vertices() の走査順である．
+  bool buildLimit(LoopLimit& limit) {
+    if (emptyMesh()) return false;
+
+    FlatMesh flat;
+    if (flatFromMeshL(*mesh_, TRIANGLE, flat) == false) return false;
+    return limit.setMesh(flat);
+  };
+
+  // mesh の頂点を極限曲面上へ射影したメッシュを submesh に作る．
+  // 頂点ごとに閉じた形のマスクを 1 回適用するだけで，細分割は行わない．
+  void projectToLimit() {
+    if (emptyMesh()) return;
+    if (emptySubMesh()) return;
+
+    LoopLimit limit;
+    if (buildLimit(limit) == false) return;
+    FlatMesh flat;
+    limit.projectToLimit(flat);
+
+    flatToMeshL(flat, *submesh_);
+    submesh_->calcAllFaceNormals();
+    std::cout << "loop limit: done. v " << submesh_->vertices_size()
+              << " f " << submesh_->faces_size() << std::endl;
+  };
+
   bool init() {
     if (emptyMesh()) return false;
     if (emptySubMesh()) return false;
@@ -143,21 +243,9 @@ class LoopSub {
     }
   };
 
-  double beta(int valence) {
-    if (valence == 3)
-      return LOOP_MASK_BETA3;
-    else if (valence > 10)
-      return calcBeta(valence);
-    else
-      return loop_beta[valence-4];
-  };
+  double beta(int valence) { return loopBeta(valence); };
 
-  double calcBeta(int valence) {
-    double dval = (double)valence;
-    double d = LOOP_MASK_38 + std::cos(2.0 * M_PI / dval) / 4.0;
-    double beta = (LOOP_MASK_58 - d * d) / dval;
-    return beta;
-  };
+  double calcBeta(int valence) { return loopCalcBeta(valence); };
 
 private:
   // original mesh
@@ -169,6 +257,9 @@ private:
   // vertices pointer
   std::vector<std::shared_ptr<VertexL> > even_;  // even vertex
   std::vector<std::shared_ptr<VertexL> > odd_;   // odd vertex
+
+  // number of threads for the flat kernels
+  int nthreads_;
 };
 
 #endif  // _LOOPSUB_HXX
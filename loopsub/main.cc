@@ -173,11 +173,14 @@ static void windowsize_callback(GLFWwindow* window, int w, int h) {
 ////////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char** argv) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " in.obj" << std::endl;
+  if ((argc != 2) && (argc != 3)) {
+    std::cerr << "Usage: " << argv[0] << " in.obj [levels]" << std::endl;
     return EXIT_FAILURE;
   }
 
+  // levels を指定した場合は，途中のレベルの MeshL を作らずに一度に細分割する
+  int levels = (argc == 3) ? std::atoi(argv[2]) : 0;
+
   // メッシュデータの読み込み
   std::shared_ptr<MeshL> mesh0 = std::make_shared<MeshL>(); // 細分割前のメッシュ
   smflio.setMesh(*mesh0);
@@ -190,7 +193,10 @@ int main(int argc, char** argv) {
   LoopSub loop0(mesh0, mesh1);
 
   // 細分割処理
-  loop0.apply();
+  if (levels > 0)
+    loop0.apply(levels);
+  else
+    loop0.apply();
 
   // ここからウインドウの初期化処理
   glfwSetErrorCallback(error_callback);
@@ -248,10 +254,16 @@ int main(int argc, char** argv) {
   //mesh1->calcSmoothVertexNormal();
 
   // メッシュ表示用 に mesh をセット
-  glmeshl.setMesh(mesh0);
-  // 細分割のコードを書いたら，下の行のコメントを外し，上の行をコメントしてください．
-  // setMesh するのは1つだけにしてください．
-  //glmeshl.setMesh(mesh1);
+  // levels 指定時は細分割後のメッシュを表示する
+  if (levels > 0) {
+    mesh1->calcSmoothVertexNormal();
+    glmeshl.setMesh(mesh1);
+  } else {
+    glmeshl.setMesh(mesh0);
+    // 細分割のコードを書いたら，下の行のコメントを外し，上の行をコメントしてください．
+    // setMesh するのは1つだけにしてください．
+    //glmeshl.setMesh(mesh1);
+  }
 
   c11fps.ResetFPS();
   
@@ -0,0 +1,190 @@
+////////////////////////////////////////////////////////////////////
+//
+// Per-level monotonic arena for flat subdivision buffers.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _FLATARENA_HXX
+#define _FLATARENA_HXX 1
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "FlatMesh.hxx"
+
+// FlatArena は，細分割 1 レベル分の配列 (FlatMesh, FlatTopology) を
+// まとめて確保する単調増加のメモリ領域である．
+//
+// 確保はポインタを進めるだけで，個々の解放は何もしない．release() で
+// そのレベルの領域を一度に解放する (上流から取ったブロックの数だけの処理)．
+// reserve() で 1 レベル分の大きさを先に与えておくと，ブロックは 1 つで済む．
+class FlatArena : public std::pmr::memory_resource {
+ public:
+  FlatArena() : bytes_(0), allocations_(0) { reserve(0); };
+  ~FlatArena() { mono_.reset(); };
+
+  FlatArena(const FlatArena&) = delete;
+  FlatArena& operator=(const FlatArena&) = delete;
+
+  // すべて解放して，次の確保に bytes 以上の最初のブロックを使う
+  void reserve(size_t bytes) {
+    mono_.reset();
+    bytes_ = 0;
+    allocations_ = 0;
+    upstream_.clear();
+    if (bytes > 0)
+      mono_.reset(new std::pmr::monotonic_buffer_resource(bytes, &upstream_));
+    else
+      mono_.reset(new std::pmr::monotonic_buffer_resource(&upstream_));
+  };
+
+  // すべて解放する
+  void release() {
+    mono_->release();
+    bytes_ = 0;
+    allocations_ = 0;
+  };
+
+  // 要求されたバイト数と回数
+  size_t bytes() const { return bytes_; };
+  size_t allocations() const { return allocations_; };
+  // 上流 (new/delete) から確保したバイト数とブロック数
+  size_t reservedBytes() const { return upstream_.bytes(); };
+  size_t blocks() const { return upstream_.blocks(); };
+
+ private:
+  // 上流のブロックを数える
+  class Upstream : public std::pmr::memory_resource {
+   public:
+    Upstream() : bytes_(0), blocks_(0){};
+    void clear() {
+      bytes_ = 0;
+      blocks_ = 0;
+    };
+    size_t bytes() const { return bytes_; };
+    size_t blocks() const { return blocks_; };
+
+   private:
+    void* do_allocate(size_t n, size_t align) override {
+      bytes_ += n;
+      ++blocks_;
+      return std::pmr::new_delete_resource()->allocate(n, align);
+    };
+    void do_deallocate(void* p, size_t n, size_t align) override {
+      bytes_ -= n;
+      --blocks_;
+      std::pmr::new_delete_resource()->deallocate(p, n, align);
+    };
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+      return this == &o;
+    };
+    size_t bytes_;
+    size_t blocks_;
+  };
+
+  void* do_allocate(size_t n, size_t align) override {
+    bytes_ += n;
+    ++allocations_;
+    return mono_->allocate(n, align);
+  };
+  void do_deallocate(void*, size_t, size_t) override {};
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+    return this == &o;
+  };
+
+  Upstream upstream_;
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> mono_;
+  size_t bytes_;
+  size_t allocations_;
+};
+
+// 細分割 1 レベル分の配列の使用量
+struct FlatLevelStats {
+  int level;
+  int vertices;
+  int faces;
+  int halfedges;
+  int edges;
+  size_t bytes;        // 配列に要求したバイト数
+  size_t allocations;  // 確保の回数
+  size_t reserved;     // 上流から確保したバイト数
+  size_t blocks;       // 上流から確保したブロック数
+};
+
+inline void printFlatLevelStats(std::ostream& os,
+                                const std::vector<FlatLevelStats>& stats) {
+  for (const FlatLevelStats& s : stats) {
+    os << "level " << s.level << ": v " << s.vertices << " f " << s.faces
+       << " arena " << s.bytes << " bytes (" << s.allocations << " allocs, "
+       << s.blocks << " blocks, " << s.reserved << " reserved)";
+    if (s.vertices > 0) os << " " << (double)s.bytes / s.vertices << " B/vertex";
+    if (s.faces > 0) os << " " << (double)s.bytes / s.faces << " B/face";
+    if (s.halfedges > 0) os << " " << (double)s.bytes / s.halfedges << " B/halfedge";
+    os << std::endl;
+  }
+}
+
+// mesh を kernel (LoopSubFlat, CCSubFlat) で levels 回細分割して submesh に格納する．
+//
+// 途中のレベルの FlatMesh と，そのレベルを作るときの FlatTopology は
+// 2 つの FlatArena に交互に確保する．2 つ前のレベルは arena ごと解放し，
+// 次の arena の大きさは直前のレベルの 4 倍と見積もって 1 ブロックで確保する．
+// 最後のレベル (submesh) とその位相は既定のメモリ資源を使う．
+// stats には途中のレベルごとの arena の使用量を格納する．
+template <class Kernel>
+bool subdivideLevels(Kernel& kernel, const FlatMesh& mesh, FlatMesh& submesh,
+                     int levels, std::vector<FlatLevelStats>* stats = nullptr) {
+  if (stats) stats->clear();
+  if (levels < 1) {
+    submesh = mesh;
+    return true;
+  }
+  FlatArena arena[2];
+  std::optional<FlatMesh> buffer[2];
+  size_t estimate = 0;
+  const FlatMesh* src = &mesh;
+  for (int l = 0; l < levels; ++l) {
+    const bool last = (l == levels - 1);
+    const int i = l % 2;
+    std::pmr::memory_resource* r = std::pmr::get_default_resource();
+    if (!last) {
+      buffer[i].reset();  // 2 つ前のレベル
+      arena[i].reserve(estimate);
+      buffer[i].emplace(&arena[i]);
+      r = &arena[i];
+    }
+    FlatMesh& dst = last ? submesh : *buffer[i];
+    if (kernel.init(*src, r) == false) return false;
+    kernel.setSplit(*src, dst);
+    kernel.setStencil(*src, dst);
+
+    if (!last) {
+      if (stats) {
+        const FlatTopology& topo = kernel.topology();
+        FlatLevelStats st;
+        st.level = l + 1;
+        st.vertices = dst.vertices_size();
+        st.faces = dst.faces_size();
+        st.halfedges = (int)dst.faces().size();
+        st.edges = topo.edges_size();
+        st.bytes = arena[i].bytes();
+        st.allocations = arena[i].allocations();
+        st.reserved = arena[i].reservedBytes();
+        st.blocks = arena[i].blocks();
+        stats->push_back(st);
+      }
+      estimate = 4 * arena[i].bytes() + arena[i].bytes() / 8;
+    }
+    src = &dst;
+  }
+  return true;
+}
+
+#endif  // _FLATARENA_HXX
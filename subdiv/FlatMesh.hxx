@@ -0,0 +1,265 @@
+////////////////////////////////////////////////////////////////////
+//
+// Index-based (flat) mesh buffers for subdivision kernels.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _FLATMESH_HXX
+#define _FLATMESH_HXX 1
+
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+#include "myEigen.hxx"
+
+#include "ParallelFor.hxx"
+
+// FlatMesh は，MeshL を使わずに細分割を行うための配列ベースのメッシュである．
+//
+// - points_: 頂点座標を structure-of-arrays で持つ (x0..xn-1, y0..yn-1, z0..zn-1)
+//            Eigen の列優先 n x 3 行列と同じ並びなので，points() で Map できる
+// - faces_ : 面の頂点インデックス列 (面サイズ fsize_ は全面で共通)
+//
+// 配列は std::pmr のメモリ資源から確保する (既定は new/delete)．
+// 細分割の途中のレベルは FlatArena を渡してまとめて確保・解放する．
+// コピーで作った FlatMesh は既定の資源を使う．
+class FlatMesh {
+ public:
+  FlatMesh() : fsize_(0){};
+  explicit FlatMesh(std::pmr::memory_resource* r)
+      : points_(r), faces_(r), fsize_(0){};
+  ~FlatMesh(){};
+
+  std::pmr::memory_resource* resource() const { return points_.get_allocator().resource(); };
+
+  int vertices_size() const { return (int)(points_.size() / 3); };
+  int faces_size() const {
+    return (fsize_ > 0) ? (int)(faces_.size() / fsize_) : 0;
+  };
+  int face_size() const { return fsize_; };
+
+  void clear() {
+    points_.clear();
+    faces_.clear();
+  };
+
+  // nv 頂点, nf 面 (面サイズ fsize) の領域を確保する
+  void resize(int nv, int nf, int fsize) {
+    fsize_ = fsize;
+    points_.resize((size_t)nv * 3);
+    faces_.resize((size_t)nf * fsize);
+  };
+
+  Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3> > points() {
+    return Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, 3> >(
+        points_.data(), vertices_size(), 3);
+  };
+  Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 3> > points() const {
+    return Eigen::Map<const Eigen::Matrix<double, Eigen::Dynamic, 3> >(
+        points_.data(), vertices_size(), 3);
+  };
+
+  // 座標軸 d (0: x, 1: y, 2: z) の先頭ポインタ
+  double* coord(int d) { return points_.data() + (size_t)d * vertices_size(); };
+  const double* coord(int d) const {
+    return points_.data() + (size_t)d * vertices_size();
+  };
+
+  Eigen::Vector3d point(int i) const {
+    const size_t n = vertices_size();
+    return Eigen::Vector3d(points_[i], points_[n + i], points_[2 * n + i]);
+  };
+  void setPoint(int i, const Eigen::Vector3d& p) {
+    const size_t n = vertices_size();
+    points_[i] = p.x();
+    points_[n + i] = p.y();
+    points_[2 * n + i] = p.z();
+  };
+
+  std::pmr::vector<int>& faces() { return faces_; };
+  const std::pmr::vector<int>& faces() const { return faces_; };
+  const int* face(int f) const { return faces_.data() + (size_t)f * fsize_; };
+
+ private:
+  std::pmr::vector<double> points_;
+  std::pmr::vector<int> faces_;
+  int fsize_;
+};
+
+//
+// FlatTopology: FlatMesh の接続情報
+//
+// ハーフエッジは陰に表現する．面 f の k 番目の角から出るハーフエッジの番号は
+// h = f * fsize + k であり，始点は faces[h]，次は同じ面の (k+1) % fsize である．
+//
+// - vout_: 頂点から出るハーフエッジの一覧 (CSR 形式の 1-ring 隣接)
+// - vout_index_: ハーフエッジの vout_ での位置 (vout_ の逆)
+// - mate_: 逆向きのハーフエッジ (境界では -1)
+// - he_edge_ / edge_he_: ハーフエッジとエッジの対応
+//
+class FlatTopology {
+ public:
+  FlatTopology() : fsize_(0), nv_(0), nf_(0){};
+  ~FlatTopology(){};
+
+  // nthreads > 1 のとき mate と境界頂点の判定を並列に行う．
+  // r を与えると配列をそのメモリ資源 (FlatArena など) から確保する．
+  void build(const FlatMesh& mesh, int nthreads = 1,
+             std::pmr::memory_resource* r = std::pmr::get_default_resource()) {
+    if (r != vout_.get_allocator().resource()) setResource(r);
+    fsize_ = mesh.face_size();
+    nv_ = mesh.vertices_size();
+    nf_ = mesh.faces_size();
+    faces_ = mesh.faces().data();
+    const int nh = (int)mesh.faces().size();
+
+    // 頂点ごとの出力ハーフエッジ (CSR)
+    vout_offset_.assign(nv_ + 1, 0);
+    for (int h = 0; h < nh; ++h) ++vout_offset_[faces_[h] + 1];
+    for (int v = 0; v < nv_; ++v) vout_offset_[v + 1] += vout_offset_[v];
+    vout_.resize(nh);
+    vout_index_.resize(nh);
+    std::pmr::vector<int> pos(vout_offset_.begin(), vout_offset_.end() - 1, r);
+    for (int h = 0; h < nh; ++h) {
+      const int i = pos[faces_[h]]++;
+      vout_[i] = h;
+      vout_index_[h] = i;
+    }
+
+    // mate: dest(h) から出るハーフエッジのうち，終点が origin(h) のもの
+    mate_.resize(nh);
+    parallelFor(nh, nthreads, [&](int begin, int end) {
+      for (int h = begin; h < end; ++h) mate_[h] = findMate(h);
+    });
+
+    // エッジ番号はハーフエッジ番号の順に付ける
+    he_edge_.resize(nh);
+    edge_he_.clear();
+    edge_he_.reserve(nh / 2 + nv_);
+    for (int h = 0; h < nh; ++h) {
+      const int m = mate_[h];
+      if ((m >= 0) && (m < h)) continue;
+      he_edge_[h] = (int)edge_he_.size();
+      if (m >= 0) he_edge_[m] = (int)edge_he_.size();
+      edge_he_.push_back(h);
+    }
+
+    // 境界頂点: 出力ハーフエッジか，その直前のハーフエッジ (入力) が mate を持たない
+    is_boundary_.assign(nv_, 0);
+    parallelFor(nv_, nthreads, [&](int begin, int end) {
+      for (int v = begin; v < end; ++v) {
+        for (int i = vout_offset_[v]; i < vout_offset_[v + 1]; ++i) {
+          const int h = vout_[i];
+          if ((mate_[h] < 0) || (mate_[prev(h)] < 0)) {
+            is_boundary_[v] = 1;
+            break;
+          }
+        }
+      }
+    });
+  };
+
+  int vertices_size() const { return nv_; };
+  int edges_size() const { return (int)edge_he_.size(); };
+  int faces_size() const { return nf_; };
+  int face_size() const { return fsize_; };
+
+  // ハーフエッジの操作
+  int face(int h) const { return h / fsize_; };
+  int next(int h) const { return (h % fsize_ == fsize_ - 1) ? h - fsize_ + 1 : h + 1; };
+  int prev(int h) const { return (h % fsize_ == 0) ? h + fsize_ - 1 : h - 1; };
+  int origin(int h) const { return faces_[h]; };
+  int dest(int h) const { return faces_[next(h)]; };
+  int mate(int h) const { return mate_[h]; };
+  int edge(int h) const { return he_edge_[h]; };
+
+  // エッジ e の代表ハーフエッジ (mate がある場合はその小さい方)
+  int edgeHalfedge(int e) const { return edge_he_[e]; };
+
+  // 頂点 v から出るハーフエッジ列 [voutBegin(v), voutEnd(v))
+  const int* voutBegin(int v) const { return vout_.data() + vout_offset_[v]; };
+  const int* voutEnd(int v) const { return vout_.data() + vout_offset_[v + 1]; };
+  int outDegree(int v) const { return vout_offset_[v + 1] - vout_offset_[v]; };
+
+  bool isBoundary(int v) const { return is_boundary_[v] != 0; };
+
+  // 頂点 v の 1-ring を反時計回りにたどるための出力ハーフエッジ
+  // - firstOut(v): 境界頂点では mate を持たない出力ハーフエッジ (境界の始まり)
+  // - ccwOut(h)  : h の次 (反時計回り) の出力ハーフエッジ．境界では -1
+  int firstOut(int v) const {
+    for (const int* it = voutBegin(v); it != voutEnd(v); ++it)
+      if (mate_[*it] < 0) return *it;
+    return (outDegree(v) > 0) ? *voutBegin(v) : -1;
+  };
+  int ccwOut(int h) const { return mate_[prev(h)]; };
+
+  // 境界頂点 v の両隣の境界頂点 (a: 出力側, b: 入力側)
+  bool boundaryNeighbors(int v, int* a, int* b) const {
+    *a = *b = -1;
+    for (const int* it = voutBegin(v); it != voutEnd(v); ++it) {
+      if (mate_[*it] < 0) *a = dest(*it);
+      if (mate_[prev(*it)] < 0) *b = origin(prev(*it));
+    }
+    return (*a >= 0) && (*b >= 0);
+  };
+
+  const std::pmr::vector<int>& voutOffsets() const { return vout_offset_; };
+  const std::pmr::vector<int>& vout() const { return vout_; };
+  const std::pmr::vector<int>& voutIndices() const { return vout_index_; };
+  const std::pmr::vector<int>& mates() const { return mate_; };
+  const std::pmr::vector<int>& edgeHalfedges() const { return edge_he_; };
+  const std::pmr::vector<char>& boundaryFlags() const { return is_boundary_; };
+
+  // 配列を解放して既定のメモリ資源に戻す
+  void clear() {
+    setResource(std::pmr::get_default_resource());
+    nv_ = nf_ = 0;
+    faces_ = nullptr;
+  };
+
+ private:
+  // 配列を空にして，以後の確保に r を使う
+  // (pmr::vector の代入ではメモリ資源が変わらないので作り直す)
+  void setResource(std::pmr::memory_resource* r) {
+    renew(vout_offset_, r);
+    renew(vout_, r);
+    renew(vout_index_, r);
+    renew(mate_, r);
+    renew(he_edge_, r);
+    renew(edge_he_, r);
+    renew(is_boundary_, r);
+  };
+  template <class T>
+  static void renew(std::pmr::vector<T>& v, std::pmr::memory_resource* r) {
+    v.~vector();
+    new (&v) std::pmr::vector<T>(r);
+  };
+
+  int findMate(int h) const {
+    const int v = origin(h);
+    const int w = dest(h);
+    for (const int* it = voutBegin(w); it != voutEnd(w); ++it) {
+      if (dest(*it) == v) return *it;
+    }
+    return -1;
+  };
+
+  int fsize_;
+  int nv_;
+  int nf_;
+  const int* faces_;
+
+  std::pmr::vector<int> vout_offset_;  // size nv + 1
+  std::pmr::vector<int> vout_;         // size nh
+  std::pmr::vector<int> vout_index_;   // size nh
+  std::pmr::vector<int> mate_;         // size nh
+  std::pmr::vector<int> he_edge_;      // size nh
+  std::pmr::vector<int> edge_he_;      // size ne
+  std::pmr::vector<char> is_boundary_; // size nv
+};
+
+#endif  // _FLATMESH_HXX
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////
+//
+// Conversion between MeshL and FlatMesh.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _FLATMESHL_HXX
+#define _FLATMESHL_HXX 1
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "myEigen.hxx"
+
+#include "FaceL.hxx"
+#include "HalfedgeL.hxx"
+#include "MeshL.hxx"
+#include "VertexL.hxx"
+
+#include "FlatMesh.hxx"
+
+// MeshL -> FlatMesh
+// 頂点は mesh.vertices() の走査順に 0, 1, ... と番号を付け直す．
+// fsize の面以外が含まれる場合は false を返す．
+inline bool flatFromMeshL(MeshL& mesh, int fsize, FlatMesh& flat) {
+  int max_id = -1;
+  for (auto& vt : mesh.vertices())
+    if (max_id < vt->id()) max_id = vt->id();
+
+  flat.resize(mesh.vertices_size(), mesh.faces_size(), fsize);
+
+  std::vector<int> index(max_id + 1, -1);
+  int i = 0;
+  for (auto& vt : mesh.vertices()) {
+    index[vt->id()] = i;
+    flat.setPoint(i, vt->point());
+    ++i;
+  }
+
+  int* fv = flat.faces().data();
+  for (auto& fc : mesh.faces()) {
+    if (fc->size() != fsize) {
+      std::cerr << "Error: A face of size " << fc->size()
+                << " is included (expected " << fsize << "). " << std::endl;
+      flat.clear();
+      return false;
+    }
+    for (auto& he : fc->halfedges()) *(fv++) = index[he->vertex()->id()];
+  }
+  return true;
+}
+
+// FlatMesh -> MeshL
+// mesh には頂点・面を追加するだけなので，空の MeshL を渡すこと．
+inline void flatToMeshL(const FlatMesh& flat, MeshL& mesh) {
+  std::vector<std::shared_ptr<VertexL> > vertices(flat.vertices_size());
+  for (int i = 0; i < flat.vertices_size(); ++i)
+    vertices[i] = mesh.addVertex(flat.point(i));
+
+  for (int f = 0; f < flat.faces_size(); ++f) {
+    const int* fv = flat.face(f);
+    std::shared_ptr<FaceL> fc = mesh.addFace();
+    for (int k = 0; k < flat.face_size(); ++k) fc->addHalfedge(vertices[fv[k]]);
+  }
+}
+
+// MeshL の頂点位置だけを FlatMesh に書き込む (位相は変わらないものとする)
+inline void flatPointsFromMeshL(MeshL& mesh, FlatMesh& flat) {
+  int i = 0;
+  for (auto& vt : mesh.vertices()) flat.setPoint(i++, vt->point());
+}
+
+// FlatMesh の頂点位置だけを MeshL に書き込む
+// mesh は flatToMeshL() で flat から作ったものとする．
+inline void flatPointsToMeshL(const FlatMesh& flat, MeshL& mesh) {
+  int i = 0;
+  for (auto& vt : mesh.vertices()) vt->setPoint(flat.point(i++));
+}
+
+#endif  // _FLATMESHL_HXX
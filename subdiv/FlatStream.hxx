@@ -0,0 +1,566 @@
+////////////////////////////////////////////////////////////////////
+//
+// Out-of-core streaming subdivision on FlatMesh.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _FLATSTREAM_HXX
+#define _FLATSTREAM_HXX 1
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mydef.h"
+
+#include "FlatArena.hxx"
+#include "FlatMesh.hxx"
+
+// 細分割結果のバイナリファイル (FlatStream の出力)
+//   char    magic[8]  "FLATSUB1"
+//   int32   面の頂点数 (3 または 4)
+//   int32   0
+//   int64   頂点数 nv
+//   int64   面数 nf
+//   double  頂点座標 [nv][3]
+//   int32   面の頂点番号 [nf][面の頂点数] (0 始まり)
+static const char FLATSUB_MAGIC[8] = {'F', 'L', 'A', 'T', 'S', 'U', 'B', '1'};
+static const int64_t FLATSUB_HEADER_SIZE = 32;
+
+inline bool flatSubSeek(FILE* fp, int64_t offset) {
+#if defined(_WIN32)
+  return _fseeki64(fp, offset, SEEK_SET) == 0;
+#else
+  return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+inline bool flatSubReadHeader(FILE* fp, int* fsize, int64_t* nv, int64_t* nf) {
+  char magic[8];
+  int32_t fs, reserved;
+  if ((fread(magic, 1, 8, fp) != 8) || memcmp(magic, FLATSUB_MAGIC, 8) ||
+      (fread(&fs, sizeof(int32_t), 1, fp) != 1) ||
+      (fread(&reserved, sizeof(int32_t), 1, fp) != 1) ||
+      (fread(nv, sizeof(int64_t), 1, fp) != 1) ||
+      (fread(nf, sizeof(int64_t), 1, fp) != 1))
+    return false;
+  *fsize = fs;
+  return true;
+}
+
+// バイナリファイルを FlatMesh に読み込む (メモリに収まる大きさのもの)
+inline bool readFlatSubFile(const char* filename, FlatMesh& mesh) {
+  FILE* fp = fopen(filename, "rb");
+  if (fp == nullptr) {
+    std::cerr << "Error: cannot open " << filename << ". " << std::endl;
+    return false;
+  }
+  int fsize;
+  int64_t nv, nf;
+  if ((flatSubReadHeader(fp, &fsize, &nv, &nf) == false) || (nv > INT_MAX) ||
+      (nf > INT_MAX)) {
+    std::cerr << "Error: " << filename << " is not a FLATSUB1 file. " << std::endl;
+    fclose(fp);
+    return false;
+  }
+  mesh.resize((int)nv, (int)nf, fsize);
+  std::vector<double> p(3 * (size_t)nv);
+  bool ok = (fread(p.data(), sizeof(double), p.size(), fp) == p.size());
+  for (int64_t i = 0; i < nv; ++i)
+    for (int d = 0; d < 3; ++d) mesh.coord(d)[i] = p[3 * i + d];
+  std::vector<int32_t> f(mesh.faces().size());
+  ok = ok && (fread(f.data(), sizeof(int32_t), f.size(), fp) == f.size());
+  std::copy(f.begin(), f.end(), mesh.faces().begin());
+  fclose(fp);
+  if (ok == false) std::cerr << "Error: " << filename << " is truncated. " << std::endl;
+  return ok;
+}
+
+// バイナリファイルを OBJ に変換する．一定の大きさのバッファで順に読み書きする．
+inline bool flatSubToOBJ(const char* binname, const char* objname) {
+  FILE* in = fopen(binname, "rb");
+  if (in == nullptr) {
+    std::cerr << "Error: cannot open " << binname << ". " << std::endl;
+    return false;
+  }
+  int fsize;
+  int64_t nv, nf;
+  if (flatSubReadHeader(in, &fsize, &nv, &nf) == false) {
+    std::cerr << "Error: " << binname << " is not a FLATSUB1 file. " << std::endl;
+    fclose(in);
+    return false;
+  }
+  FILE* out = fopen(objname, "w");
+  if (out == nullptr) {
+    std::cerr << "Error: cannot open " << objname << ". " << std::endl;
+    fclose(in);
+    return false;
+  }
+  const int64_t block = 1 << 16;
+  bool ok = true;
+  std::vector<double> p(3 * block);
+  for (int64_t i = 0; ok && (i < nv); i += block) {
+    const int64_t n = std::min(block, nv - i);
+    ok = (fread(p.data(), sizeof(double), 3 * n, in) == (size_t)(3 * n));
+    for (int64_t k = 0; ok && (k < n); ++k)
+      fprintf(out, "v %.10g %.10g %.10g\n", p[3 * k], p[3 * k + 1], p[3 * k + 2]);
+  }
+  std::vector<int32_t> f(fsize * block);
+  for (int64_t i = 0; ok && (i < nf); i += block) {
+    const int64_t n = std::min(block, nf - i);
+    ok = (fread(f.data(), sizeof(int32_t), fsize * n, in) == (size_t)(fsize * n));
+    for (int64_t k = 0; ok && (k < n); ++k) {
+      fputc('f', out);
+      for (int j = 0; j < fsize; ++j) fprintf(out, " %d", f[fsize * k + j] + 1);
+      fputc('\n', out);
+    }
+  }
+  fclose(in);
+  if (fclose(out) != 0) ok = false;
+  if (ok == false) std::cerr << "Error: cannot convert " << binname << ". " << std::endl;
+  return ok;
+}
+
+// ストリーミング細分割の統計
+struct FlatStreamStats {
+  int clusters;
+  int max_cluster_faces;  // 1 クラスタの面数の最大
+  int max_local_faces;    // 1 クラスタのハローを含む面数の最大
+  int64_t halo_faces;     // ハローの面数の合計
+  size_t peak_bytes;      // 1 クラスタの細分割に使った配列の大きさ (見積もり) の最大
+  int64_t vertices;       // 出力の頂点数
+  int64_t faces;          // 出力の面数
+};
+
+// FlatStream は，出力がメモリに収まらない高いレベルの細分割を
+// 面のクラスタごとに行い，結果を直接ファイルに書き出す．
+// Kernel は LoopSubFlat または CCSubFlat である．入力 (レベル 0) はメモリに置く．
+//
+// 面を辺で隣り合う順に集めてクラスタを作り，クラスタの頂点に接する面
+// (one-ring halo) を加えて細分割する．面の細分割結果はその面の one-ring だけで
+// 決まるので，クラスタの面の部分は全体を細分割したものと一致する．
+// ハローの細分割結果は捨てる．
+//
+// 出力の頂点番号は元のメッシュの要素から決める (N = 2^levels)．
+//   [0, nv)                      : 元の頂点
+//   nv + e * (N - 1) + k         : 元のエッジ e 上の点 (番号の小さい端点から k + 1 番目)
+//   nv + ne * (N - 1) + f * I + k : 元の面 f の内部の点
+// クラスタの境界の頂点はどのクラスタでも同じ番号になり，座標は最初に
+// その頂点を含んだクラスタだけが書き込む．面 f から生成された面は
+// f * 4^levels から連続して並ぶ (全体を細分割したときと同じ順番)．
+//
+// ファイルの決まった位置に書き込むので，作業に使うメモリは setMemoryBudget()
+// で与えた大きさ (1 クラスタ分) と入力メッシュの大きさで決まり，出力の大きさによらない．
+template <class Kernel>
+class FlatStream {
+ public:
+  enum Format { BINARY, OBJ };
+  enum { MaxLevel = 12 };
+
+  FlatStream() : nthreads_(1), budget_((size_t)256 * 1024 * 1024) { clearStats(); };
+  ~FlatStream(){};
+
+  void setNumThreads(int n) {
+    nthreads_ = (n > 0) ? n : 1;
+    kernel_.setNumThreads(nthreads_);
+  };
+  // 1 クラスタの細分割に使うメモリの上限 (バイト)
+  void setMemoryBudget(size_t bytes) { budget_ = bytes; };
+  size_t memoryBudget() const { return budget_; };
+
+  const FlatStreamStats& stats() const { return stats_; };
+
+  // mesh を levels 回細分割して filename に書き出す．
+  // OBJ のときは filename + ".part" にバイナリで書き出してから変換する．
+  bool apply(const FlatMesh& mesh, int levels, const std::string& filename,
+             Format format = BINARY) {
+    clearStats();
+    const int fs = mesh.face_size();
+    if ((fs != TRIANGLE) && (fs != RECTANGLE)) {
+      std::cerr << "Error: face size must be 3 or 4. " << std::endl;
+      return false;
+    }
+    if ((levels < 1) || (levels > MaxLevel)) {
+      std::cerr << "Error: level must be in [1, " << (int)MaxLevel << "]. " << std::endl;
+      return false;
+    }
+    levels_ = levels;
+    topo_.build(mesh, nthreads_);
+    const int64_t n = (int64_t)1 << levels;
+    const int64_t inner = (fs == TRIANGLE) ? (n - 1) * (n - 2) / 2 : (n - 1) * (n - 1);
+    nv_out_ = topo_.vertices_size() + topo_.edges_size() * (n - 1) +
+              topo_.faces_size() * inner;
+    nf_out_ = (int64_t)topo_.faces_size() << (2 * levels);
+    if (nv_out_ > INT_MAX) {
+      std::cerr << "Error: too many vertices (" << nv_out_ << "). " << std::endl;
+      return false;
+    }
+    setCorners(fs);
+
+    const std::string binname = (format == OBJ) ? filename + ".part" : filename;
+    fp_ = fopen(binname.c_str(), "wb");
+    if (fp_ == nullptr) {
+      std::cerr << "Error: cannot open " << binname << ". " << std::endl;
+      return false;
+    }
+    bool ok = writeHeader(fs);
+
+    // 面のない頂点はそのまま出力する
+    for (int v = 0; ok && (v < topo_.vertices_size()); ++v) {
+      if (topo_.outDegree(v) > 0) continue;
+      const double p[3] = {mesh.coord(0)[v], mesh.coord(1)[v], mesh.coord(2)[v]};
+      ok = flatSubSeek(fp_, FLATSUB_HEADER_SIZE + (int64_t)v * 3 * sizeof(double)) &&
+           (fwrite(p, sizeof(double), 3, fp_) == 3);
+    }
+
+    // クラスタごとに細分割する
+    const int nf = topo_.faces_size();
+    cluster_of_.assign(nf, -1);
+    face_mark_.assign(nf, -1);
+    vert_mark_.assign(topo_.vertices_size(), -1);
+    local_of_.assign(topo_.vertices_size(), -1);
+    vowner_.assign(topo_.vertices_size(), -1);
+    eowner_.assign(topo_.edges_size(), -1);
+    queue_.clear();
+    head_ = 0;
+    seed_ = 0;
+    const size_t per_face = bytesPerFineFace(fs) << (2 * levels);
+    const int64_t target = std::max<int64_t>(1, (int64_t)(budget_ / per_face));
+    while (ok && nextCluster(mesh, target)) ok = subdivideCluster(mesh);
+
+    if (fclose(fp_) != 0) ok = false;
+    fp_ = nullptr;
+    if (ok == false) {
+      std::cerr << "Error: cannot write " << binname << ". " << std::endl;
+      return false;
+    }
+    stats_.vertices = nv_out_;
+    stats_.faces = nf_out_;
+
+    if (format == OBJ) {
+      ok = flatSubToOBJ(binname.c_str(), filename.c_str());
+      remove(binname.c_str());
+    }
+    return ok;
+  };
+
+  // 細分割後の面 1 つあたりの作業領域の見積もり (バイト)．
+  // 最終レベルの頂点と面，1 つ前のレベルの位相，途中のレベルの arena を含む．
+  static size_t bytesPerFineFace(int fs) { return (fs == TRIANGLE) ? 64 : 96; };
+
+ private:
+  // 細分割後の面の頂点が，元の面のどこにあるか
+  enum { CornerVertex, CornerEdge, CornerInner };
+  struct Corner {
+    int type;
+    int i;  // CornerVertex: 元の面の頂点, CornerEdge: 元の面のハーフエッジ
+    int k;  // CornerEdge: ハーフエッジの始点からの距離, CornerInner: 内部の点の番号
+  };
+
+  void clearStats() { memset(&stats_, 0, sizeof(stats_)); };
+
+  bool writeHeader(int fs) {
+    const int32_t h[2] = {fs, 0};
+    const int64_t n[2] = {nv_out_, nf_out_};
+    return (fwrite(FLATSUB_MAGIC, 1, 8, fp_) == 8) &&
+           (fwrite(h, sizeof(int32_t), 2, fp_) == 2) &&
+           (fwrite(n, sizeof(int64_t), 2, fp_) == 2);
+  };
+
+  // 元の面の中の位置 (N = 2^levels を単位とする整数座標) を，細分割後の
+  // 面の順番 (LoopSubFlat / CCSubFlat の setSplit() と同じ) に求めておく．
+  // 三角形は重心座標 (b0, b1, b2)，四角形は (u, v) で，頂点 0, 1, 2, 3 が
+  // (0, 0), (N, 0), (N, N), (0, N) である．
+  void setCorners(int fs) {
+    const int n = 1 << levels_;
+    std::vector<int> p(fs * 3, 0);
+    if (fs == TRIANGLE) {
+      for (int k = 0; k < 3; ++k) p[3 * k + k] = n;
+    } else {
+      p[3] = n;                 // (N, 0)
+      p[6] = n; p[7] = n;       // (N, N)
+      p[10] = n;                // (0, N)
+    }
+    corners_.clear();
+    corners_.reserve((size_t)fs << (2 * levels_));
+    splitCorners(fs, p, 0);
+  };
+
+  void splitCorners(int fs, const std::vector<int>& p, int level) {
+    if (level == levels_) {
+      for (int k = 0; k < fs; ++k) corners_.push_back(classify(fs, &p[3 * k]));
+      return;
+    }
+    auto mid = [&](int a, int b, int* c) {
+      for (int d = 0; d < 3; ++d) c[d] = (p[3 * a + d] + p[3 * b + d]) / 2;
+    };
+    std::vector<int> c(fs * 3);
+    if (fs == TRIANGLE) {
+      // (v0, o0, o2), (v1, o1, o0), (v2, o2, o1), (o0, o1, o2)
+      for (int k = 0; k < 3; ++k) {
+        std::copy(&p[3 * k], &p[3 * k] + 3, &c[0]);
+        mid(k, (k + 1) % 3, &c[3]);
+        mid((k + 2) % 3, k, &c[6]);
+        splitCorners(fs, c, level + 1);
+      }
+      mid(0, 1, &c[0]);
+      mid(1, 2, &c[3]);
+      mid(2, 0, &c[6]);
+      splitCorners(fs, c, level + 1);
+    } else {
+      // (v_k, e_k, face vertex, e_k-1)
+      for (int k = 0; k < 4; ++k) {
+        std::copy(&p[3 * k], &p[3 * k] + 3, &c[0]);
+        mid(k, (k + 1) & 3, &c[3]);
+        for (int d = 0; d < 3; ++d)
+          c[6 + d] = (p[d] + p[3 + d] + p[6 + d] + p[9 + d]) / 4;
+        mid((k + 3) & 3, k, &c[9]);
+        splitCorners(fs, c, level + 1);
+      }
+    }
+  };
+
+  Corner classify(int fs, const int* b) const {
+    const int n = 1 << levels_;
+    Corner c = {CornerInner, 0, 0};
+    if (fs == TRIANGLE) {
+      for (int i = 0; i < 3; ++i)
+        if (b[i] == n) return {CornerVertex, i, 0};
+      // 頂点 i + 2 の重みが 0 ならハーフエッジ i (頂点 i -> i + 1) の上
+      for (int i = 0; i < 3; ++i)
+        if (b[(i + 2) % 3] == 0) return {CornerEdge, i, b[(i + 1) % 3]};
+      // 行 b1 には N - 1 - b1 個の点がある
+      c.k = (b[1] - 1) * (n - 1) - (b[1] - 1) * b[1] / 2 + (b[2] - 1);
+      return c;
+    }
+    const int u = b[0], v = b[1];
+    if ((u == 0) && (v == 0)) return {CornerVertex, 0, 0};
+    if ((u == n) && (v == 0)) return {CornerVertex, 1, 0};
+    if ((u == n) && (v == n)) return {CornerVertex, 2, 0};
+    if ((u == 0) && (v == n)) return {CornerVertex, 3, 0};
+    if (v == 0) return {CornerEdge, 0, u};
+    if (u == n) return {CornerEdge, 1, v};
+    if (v == n) return {CornerEdge, 2, n - u};
+    if (u == 0) return {CornerEdge, 3, n - v};
+    c.k = (u - 1) * (n - 1) + (v - 1);
+    return c;
+  };
+
+  // 辺で隣り合う面を順に集めて，ハローを含む面数が target に達するまで
+  // クラスタを大きくする．
+  bool nextCluster(const FlatMesh& mesh, int64_t target) {
+    const int fs = mesh.face_size();
+    const int nf = topo_.faces_size();
+    const int id = stats_.clusters;
+    const int* fv = mesh.faces().data();
+    cluster_.clear();
+    halo_.clear();
+    int64_t local = 0;
+    while (cluster_.empty() || (local < target)) {
+      int f;
+      if (head_ < queue_.size()) {
+        f = queue_[head_++];
+      } else {
+        while ((seed_ < nf) && (cluster_of_[seed_] >= 0)) ++seed_;
+        if (seed_ == nf) break;
+        f = seed_;
+      }
+      if (cluster_of_[f] >= 0) continue;
+      cluster_of_[f] = id;
+      cluster_.push_back(f);
+      if (face_mark_[f] != id) {
+        face_mark_[f] = id;
+        ++local;
+      }
+      for (int k = 0; k < fs; ++k) {
+        const int v = fv[fs * f + k];
+        if (vert_mark_[v] != id) {
+          vert_mark_[v] = id;
+          for (const int* it = topo_.voutBegin(v); it != topo_.voutEnd(v); ++it) {
+            const int g = topo_.face(*it);
+            if (face_mark_[g] == id) continue;
+            face_mark_[g] = id;
+            ++local;
+            halo_.push_back(g);
+          }
+        }
+        const int m = topo_.mate(fs * f + k);
+        if ((m >= 0) && (cluster_of_[topo_.face(m)] < 0)) queue_.push_back(topo_.face(m));
+      }
+    }
+    if (head_ > queue_.size() / 2) {
+      queue_.erase(queue_.begin(), queue_.begin() + head_);
+      head_ = 0;
+    }
+    if (cluster_.empty()) return false;
+
+    // クラスタに入った面をハローから除く
+    halo_.erase(std::remove_if(halo_.begin(), halo_.end(),
+                               [&](int g) { return cluster_of_[g] == id; }),
+                halo_.end());
+    ++stats_.clusters;
+    stats_.max_cluster_faces = std::max(stats_.max_cluster_faces, (int)cluster_.size());
+    stats_.max_local_faces =
+        std::max(stats_.max_local_faces, (int)(cluster_.size() + halo_.size()));
+    stats_.halo_faces += halo_.size();
+    return true;
+  };
+
+  bool subdivideCluster(const FlatMesh& mesh) {
+    const int fs = mesh.face_size();
+    const int id = stats_.clusters - 1;
+    const int* fv = mesh.faces().data();
+
+    // クラスタ (先頭) とハローの面からなるメッシュ
+    int nlv = 0;
+    lverts_.clear();
+    auto addFace = [&](int f) {
+      for (int k = 0; k < fs; ++k) {
+        const int v = fv[fs * f + k];
+        if ((local_of_[v] >= 0) && (local_of_[v] < nlv) && (lverts_[local_of_[v]] == v))
+          continue;
+        local_of_[v] = nlv++;
+        lverts_.push_back(v);
+      }
+    };
+    for (int f : cluster_) addFace(f);
+    for (int f : halo_) addFace(f);
+    const int nlf = (int)(cluster_.size() + halo_.size());
+    local_.resize(nlv, nlf, fs);
+    for (int i = 0; i < nlv; ++i)
+      for (int d = 0; d < 3; ++d) local_.coord(d)[i] = mesh.coord(d)[lverts_[i]];
+    int* lf = local_.faces().data();
+    for (int j = 0; j < nlf; ++j) {
+      const int f = (j < (int)cluster_.size()) ? cluster_[j] : halo_[j - cluster_.size()];
+      for (int k = 0; k < fs; ++k) lf[fs * j + k] = local_of_[fv[fs * f + k]];
+    }
+
+    if (kernel_.apply(local_, fine_, levels_) == false) return false;
+    stats_.peak_bytes = std::max(stats_.peak_bytes, workingBytes());
+
+    // クラスタの面から生成された面を書き出す
+    const int64_t n = (int64_t)1 << levels_;
+    const int per = 1 << (2 * levels_);
+    const int64_t inner = (fs == TRIANGLE) ? (n - 1) * (n - 2) / 2 : (n - 1) * (n - 1);
+    const int64_t nv = topo_.vertices_size();
+    const int64_t ne = topo_.edges_size();
+    const int64_t face_offset = FLATSUB_HEADER_SIZE + nv_out_ * 3 * sizeof(double);
+    gid_.assign(fine_.vertices_size(), -1);
+    wverts_.clear();
+    block_.resize((size_t)per * fs);
+    for (int c = 0; c < (int)cluster_.size(); ++c) {
+      const int f = cluster_[c];
+      for (int r = 0; r < per; ++r) {
+        const int* sf = fine_.face(c * per + r);
+        for (int k = 0; k < fs; ++k) {
+          const int lv = sf[k];
+          if (gid_[lv] < 0) {
+            const Corner& cn = corners_[(size_t)r * fs + k];
+            int64_t g;
+            bool owned = true;
+            if (cn.type == CornerVertex) {
+              g = fv[fs * f + cn.i];
+              if (vowner_[g] < 0) vowner_[g] = id;
+              owned = (vowner_[g] == id);
+            } else if (cn.type == CornerEdge) {
+              const int h = fs * f + cn.i;
+              const int e = topo_.edge(h);
+              const int pos = (topo_.origin(h) < topo_.dest(h)) ? cn.k : (int)n - cn.k;
+              g = nv + e * (n - 1) + pos - 1;
+              if (eowner_[e] < 0) eowner_[e] = id;
+              owned = (eowner_[e] == id);
+            } else {
+              g = nv + ne * (n - 1) + f * inner + cn.k;
+            }
+            gid_[lv] = (int)g;
+            if (owned) wverts_.push_back(std::make_pair((int)g, lv));
+          }
+          block_[(size_t)r * fs + k] = gid_[lv];
+        }
+      }
+      if ((flatSubSeek(fp_, face_offset + (int64_t)f * per * fs * sizeof(int32_t)) ==
+           false) ||
+          (fwrite(block_.data(), sizeof(int32_t), block_.size(), fp_) != block_.size()))
+        return false;
+    }
+
+    // 頂点は番号順に並べて，連続する番号ごとにまとめて書き込む
+    std::sort(wverts_.begin(), wverts_.end());
+    size_t i = 0;
+    while (i < wverts_.size()) {
+      size_t j = i;
+      pbuf_.clear();
+      while ((j < wverts_.size()) && (wverts_[j].first == wverts_[i].first + (int)(j - i))) {
+        for (int d = 0; d < 3; ++d) pbuf_.push_back(fine_.coord(d)[wverts_[j].second]);
+        ++j;
+      }
+      if ((flatSubSeek(fp_, FLATSUB_HEADER_SIZE +
+                                (int64_t)wverts_[i].first * 3 * sizeof(double)) == false) ||
+          (fwrite(pbuf_.data(), sizeof(double), pbuf_.size(), fp_) != pbuf_.size()))
+        return false;
+      i = j;
+    }
+    return true;
+  };
+
+  // 1 クラスタの細分割に使った配列の大きさ
+  size_t workingBytes() const {
+    size_t b = local_.vertices_size() * 3 * sizeof(double) +
+               local_.faces().size() * sizeof(int) +
+               fine_.vertices_size() * 3 * sizeof(double) +
+               fine_.faces().size() * sizeof(int) + fine_.vertices_size() * sizeof(int);
+    // 最後の 2 レベル分の arena
+    const std::vector<FlatLevelStats>& ls = kernel_.levelStats();
+    for (int i = std::max(0, (int)ls.size() - 2); i < (int)ls.size(); ++i)
+      b += ls[i].reserved;
+    // 最終レベルを作るときの位相 (mate と he_edge は同じ大きさ)
+    const FlatTopology& t = kernel_.topology();
+    b += (2 * t.mates().size() + t.vout().size() + t.voutIndices().size() +
+          t.voutOffsets().size() + t.edgeHalfedges().size()) * sizeof(int) +
+         t.boundaryFlags().size();
+    return b;
+  };
+
+  Kernel kernel_;
+  FlatTopology topo_;  // 入力メッシュの位相
+  int nthreads_;
+  size_t budget_;
+  int levels_;
+  int64_t nv_out_;
+  int64_t nf_out_;
+  FILE* fp_;
+  FlatStreamStats stats_;
+
+  std::vector<Corner> corners_;  // [4^levels][面の頂点数]
+  std::vector<int> cluster_of_;  // 面 -> クラスタ
+  std::vector<int> face_mark_;   // 面 -> 最後に含んだクラスタ (ハローを含む)
+  std::vector<int> vert_mark_;   // 頂点 -> 最後に含んだクラスタ
+  std::vector<int> local_of_;    // 頂点 -> クラスタのメッシュの頂点
+  std::vector<int> vowner_;      // 元の頂点 -> 座標を書き込んだクラスタ
+  std::vector<int> eowner_;      // 元のエッジ -> 座標を書き込んだクラスタ
+  std::vector<int> queue_;
+  size_t head_;
+  int seed_;
+
+  // 1 クラスタ分の作業領域
+  std::vector<int> cluster_;
+  std::vector<int> halo_;
+  std::vector<int> lverts_;
+  FlatMesh local_;
+  FlatMesh fine_;
+  std::vector<int> gid_;
+  std::vector<std::pair<int, int> > wverts_;
+  std::vector<int32_t> block_;
+  std::vector<double> pbuf_;
+};
+
+#endif  // _FLATSTREAM_HXX
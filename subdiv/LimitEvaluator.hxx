@@ -0,0 +1,523 @@
+////////////////////////////////////////////////////////////////////
+//
+// Exact limit-surface evaluation for subdivision surfaces.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _LIMITEVALUATOR_HXX
+#define _LIMITEVALUATOR_HXX 1
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "myEigen.hxx"
+
+#include "FlatMesh.hxx"
+#include "SubdivOperator.hxx"
+
+//
+// パッチの制御点の収集
+//
+// ハーフエッジ h を角 0 とする面について，各角のまわりの面の頂点
+// (= 各角の 1-ring) を重複なく集める．並びは h からの局所的な位相だけで
+// 決まるので，同じ位相の近傍からは同じ順序の制御点列が得られる．
+// 角のいずれかが境界頂点のときは false を返す．
+//
+inline bool gatherPatch(const FlatTopology& topo, int h, std::vector<int>& idx) {
+  idx.clear();
+  auto add = [&](int v) {
+    if (std::find(idx.begin(), idx.end(), v) == idx.end()) idx.push_back(v);
+  };
+  const int fs = topo.face_size();
+  int g = h;
+  for (int k = 0; k < fs; ++k, g = topo.next(g)) add(topo.origin(g));
+
+  g = h;
+  for (int k = 0; k < fs; ++k, g = topo.next(g)) {
+    int o = g;
+    do {
+      int x = topo.next(o);
+      for (int j = 1; j < fs; ++j, x = topo.next(x)) add(topo.origin(x));
+      o = topo.ccwOut(o);
+    } while ((o >= 0) && (o != g));
+    if (o < 0) return false;
+  }
+  return true;
+}
+
+//
+// 1 つの頂点 (valence n) のまわりに正則な面を R 層並べた局所メッシュ
+//
+// 扇形 n 個を中心で貼り合わせる．各扇形は格子 (a, b) (0 <= a, b) で，
+// 扇形 i の (0, b) は扇形 i+1 の (b, 0) と同じ頂点である．
+// 面 0 は中心を角 0 に持つ．座標は扇形の角度を 2 pi / n とした平面上の格子で，
+// n が正則な valence のときは正則格子そのものになる．
+//
+inline void makeWedgeMesh(int n, int fsize, int R, FlatMesh& mesh) {
+  const bool tri = (fsize == 3);
+  const int per = tri ? R * (R + 1) / 2 : R * (R + 1);
+
+  auto index = [&](int i, int a, int b) -> int {
+    if ((a == 0) && (b == 0)) return 0;
+    if (a == 0) {
+      i = (i + 1) % n;
+      a = b;
+      b = 0;
+    }
+    if (tri) return 1 + i * per + (a - 1) * (R + 1) - (a - 1) * a / 2 + b;
+    return 1 + i * per + (a - 1) * (R + 1) + b;
+  };
+
+  std::vector<int> faces;
+  for (int i = 0; i < n; ++i) {
+    for (int a = 0; a < R; ++a) {
+      for (int b = 0; b < R; ++b) {
+        if (tri) {
+          if (a + b <= R - 1) {
+            faces.push_back(index(i, a, b));
+            faces.push_back(index(i, a + 1, b));
+            faces.push_back(index(i, a, b + 1));
+          }
+          if (a + b <= R - 2) {
+            faces.push_back(index(i, a + 1, b));
+            faces.push_back(index(i, a + 1, b + 1));
+            faces.push_back(index(i, a, b + 1));
+          }
+        } else {
+          faces.push_back(index(i, a, b));
+          faces.push_back(index(i, a + 1, b));
+          faces.push_back(index(i, a + 1, b + 1));
+          faces.push_back(index(i, a, b + 1));
+        }
+      }
+    }
+  }
+
+  mesh.resize(1 + n * per, (int)faces.size() / fsize, fsize);
+  mesh.faces().assign(faces.begin(), faces.end());
+  mesh.setPoint(0, Eigen::Vector3d::Zero());
+  for (int i = 0; i < n; ++i) {
+    const double t0 = 2.0 * M_PI * i / n, t1 = 2.0 * M_PI * (i + 1) / n;
+    const Eigen::Vector3d d0(std::cos(t0), std::sin(t0), 0.0);
+    const Eigen::Vector3d d1(std::cos(t1), std::sin(t1), 0.0);
+    for (int a = 1; a <= R; ++a)
+      for (int b = 0; b <= (tri ? R - a : R); ++b)
+        mesh.setPoint(index(i, a, b), a * d0 + b * d1);
+  }
+}
+
+//
+// LimitEvaluator: 細分割曲面の極限曲面を，再帰的な細分割を行わずに評価する
+//
+// Scheme には LoopLimitScheme または CCLimitScheme を指定する．
+//
+// - limitPoint()   : 頂点の極限点・極限法線 (閉じた形のマスク)
+// - projectToLimit(): 全頂点を極限点へ射影したメッシュ
+// - evaluate()     : 面 f のパラメータ (u, v) の極限点・極限法線
+//
+// evaluate() は Stam の方法に従う．正則な面は多項式パッチ (Loop: 4 次の
+// box spline, Catmull-Clark: 双 3 次 B-spline) を直接評価し，特異頂点を
+// 1 つ持つ面は，特異頂点のまわりの制御点 K 個に細分割行列 A を m 回掛けて
+// (u, v) を含む正則な子パッチの制御点を求める．
+//
+// A やパッチの基底は，Scheme のカーネル (LoopSubFlat / CCSubFlat) で局所メッシュを
+// 細分割した行列から valence ごとに数値的に取り出す．A の固有分解は使わず，
+// 子パッチの制御点を与える行列 B_j A^(m-1) を m = 1 .. MaxDepth について
+// 表にしておく．制御点は setMesh() で面ごとに集めておくので，1 点の評価は
+// 小さな行列積だけで済む．
+//
+// 特異頂点を 2 つ以上持つ面がある場合は，1 回細分割したメッシュ上で評価する．
+// 境界頂点を角に持つ面は評価できない (evaluate() が false を返す)．
+//
+template <class Scheme>
+class LimitEvaluator {
+ public:
+  typedef typename Scheme::Kernel Kernel;
+
+  // この深さより特異頂点に近い点は，特異頂点の極限点で置き換える
+  enum { MaxDepth = 40 };
+
+  LimitEvaluator() : refined_(false){};
+  ~LimitEvaluator(){};
+
+  // FlatTopology が内部のメッシュを参照するのでコピーはしない
+  LimitEvaluator(const LimitEvaluator&) = delete;
+  LimitEvaluator& operator=(const LimitEvaluator&) = delete;
+
+  bool setMesh(const FlatMesh& mesh) {
+    clear();
+    if (mesh.face_size() != Scheme::FaceSize) {
+      std::cerr << "Error: " << Scheme::name()
+                << " limit evaluation needs faces of size " << Scheme::FaceSize
+                << ". " << std::endl;
+      return false;
+    }
+    mesh_ = mesh;
+    topo_.build(mesh_);
+
+    // 特異頂点を 2 つ以上持つ面があれば 1 回細分割して特異頂点を分離する
+    classify(topo_, ftype_);
+    refined_ = std::find(ftype_.begin(), ftype_.end(), MultipleEV) != ftype_.end();
+    if (refined_) {
+      Kernel kernel;
+      if (kernel.apply(mesh_, fine_) == false) return false;
+      fine_topo_.build(fine_);
+      classify(fine_topo_, ftype_);
+    }
+
+    if (fitBasis() == false) return false;
+
+    // 評価できる面の制御点をあらかじめ集めておく
+    const FlatTopology& topo = evalTopology();
+    const int fs = Scheme::FaceSize;
+    std::vector<int> idx;
+    patch_offset_.assign(topo.faces_size() + 1, 0);
+    patch_idx_.clear();
+    for (int f = 0; f < topo.faces_size(); ++f) {
+      if (ftype_[f] >= Regular) {
+        const int k = (ftype_[f] == Regular) ? 0 : ftype_[f];
+        gatherPatch(topo, f * fs + k, idx);
+        if (ftype_[f] >= 0) {
+          const int n = topo.outDegree(topo.origin(f * fs + k));
+          if (tables_.count(n) == 0)
+            if (buildTable(n, tables_[n]) == false) return false;
+          if ((int)idx.size() != tables_[n].P[0][0].cols()) ftype_[f] = Unsupported;
+        } else if ((int)idx.size() != coef_.rows()) {
+          ftype_[f] = Unsupported;
+        }
+        if (ftype_[f] >= Regular) patch_idx_.insert(patch_idx_.end(), idx.begin(), idx.end());
+      }
+      patch_offset_[f + 1] = (int)patch_idx_.size();
+    }
+    return true;
+  };
+
+  void clear() {
+    mesh_ = FlatMesh();
+    fine_ = FlatMesh();
+    ftype_.clear();
+    patch_offset_.clear();
+    patch_idx_.clear();
+    tables_.clear();
+    refined_ = false;
+  };
+
+  const FlatMesh& mesh() const { return mesh_; };
+  const FlatTopology& topology() const { return topo_; };
+
+  // 頂点 v の極限点 p と極限法線 n (n は nullptr なら求めない)
+  void limitPoint(int v, Eigen::Vector3d& p, Eigen::Vector3d* n = nullptr) const {
+    limitPoint(mesh_, topo_, v, p, n);
+  };
+
+  // setMesh() のメッシュの全頂点を極限点へ射影して limit に格納する
+  void projectToLimit(FlatMesh& limit) const {
+    limit = mesh_;
+    for (int v = 0; v < mesh_.vertices_size(); ++v) {
+      Eigen::Vector3d p;
+      limitPoint(v, p);
+      limit.setPoint(v, p);
+    }
+  };
+
+  // 全頂点の極限法線
+  void limitNormals(std::vector<Eigen::Vector3d>& normals) const {
+    normals.resize(mesh_.vertices_size());
+    for (int v = 0; v < mesh_.vertices_size(); ++v) {
+      Eigen::Vector3d p;
+      limitPoint(v, p, &normals[v]);
+    }
+  };
+
+  // 面 f のパラメータ (u, v) の極限点・極限法線を求める．
+  // (u, v) は Scheme の面パラメータ (Loop: 重心座標 (1-u-v, u, v),
+  // Catmull-Clark: 角 0 を原点とし角 1 方向が u, 角 3 方向が v) である．
+  bool evaluate(int f, double u, double v, Eigen::Vector3d& p,
+                Eigen::Vector3d* n = nullptr) const {
+    if ((f < 0) || (f >= mesh_.faces_size())) return false;
+
+    // 1 回細分割している場合は子の面とそのパラメータに移る
+    if (refined_) {
+      double s, t;
+      const int j = Scheme::child(u, v, &s, &t);
+      f = 4 * f + j;
+      u = s;
+      v = t;
+    }
+    const FlatMesh& mesh = evalMesh();
+    const FlatTopology& topo = evalTopology();
+    const int type = ftype_[f];
+    const int fs = Scheme::FaceSize;
+    if (type < Regular) return false;
+
+    const int* idx = patch_idx_.data() + patch_offset_[f];
+    const int K = patch_offset_[f + 1] - patch_offset_[f];
+    if (type == Regular) {
+      evalPatch(mesh, idx, K, nullptr, u, v, p, n);
+      return true;
+    }
+
+    // 特異頂点が角 0 になるようにパラメータを回す
+    const int h = f * fs + type;
+    double s, t;
+    Scheme::rotate(type, u, v, &s, &t);
+    const Table& table = tables_.find(topo.outDegree(topo.origin(h)))->second;
+
+    int m = 0, j;
+    while ((j = Scheme::child(s, t, &s, &t)) == 0) {
+      if (++m == MaxDepth) {
+        limitPoint(mesh, topo, topo.origin(h), p, n);
+        return true;
+      }
+    }
+    evalPatch(mesh, idx, K, &table.P[j - 1][m], s, t, p, n);
+    return true;
+  };
+
+  // 評価に使うメッシュ (特異頂点を分離するために細分割した場合はそのメッシュ)
+  bool refined() const { return refined_; };
+  const FlatMesh& evalMesh() const { return refined_ ? fine_ : mesh_; };
+  const FlatTopology& evalTopology() const { return refined_ ? fine_topo_ : topo_; };
+
+ private:
+  // 面の種類 (0 以上は特異頂点の角番号)
+  enum { MultipleEV = -3, Unsupported = -2, Regular = -1 };
+
+  // 正則パッチの制御点・単項式の数と次数の上限
+  enum { MaxPatch = 16, MaxDegree = 4 };
+
+  // valence ごとの表: P[j][m] = B_(j+1) A^m (子パッチ j+1 の制御点 x K)
+  struct Table {
+    std::vector<Eigen::MatrixXd> P[3];
+  };
+
+  void classify(const FlatTopology& topo, std::vector<int>& ftype) const {
+    const int fs = Scheme::FaceSize;
+    ftype.assign(topo.faces_size(), Regular);
+    for (int f = 0; f < topo.faces_size(); ++f) {
+      int nev = 0;
+      for (int k = 0; k < fs; ++k) {
+        const int v = topo.origin(f * fs + k);
+        if (topo.isBoundary(v)) {
+          ftype[f] = Unsupported;
+          break;
+        }
+        if (topo.outDegree(v) != Scheme::RegularValence) {
+          ftype[f] = k;
+          ++nev;
+        }
+      }
+      if ((ftype[f] != Unsupported) && (nev > 1)) ftype[f] = MultipleEV;
+    }
+  };
+
+  void limitPoint(const FlatMesh& mesh, const FlatTopology& topo, int v,
+                  Eigen::Vector3d& p, Eigen::Vector3d* n) const {
+    p.setZero();
+    Scheme::limitStencil(topo, v, [&](int c, double w) { p += w * mesh.point(c); });
+    if (n == nullptr) return;
+    Eigen::Vector3d t1 = Eigen::Vector3d::Zero(), t2 = Eigen::Vector3d::Zero();
+    Scheme::tangentStencils(topo, v,
+                            [&](int c, double w) { t1 += w * mesh.point(c); },
+                            [&](int c, double w) { t2 += w * mesh.point(c); });
+    *n = t1.cross(t2);
+    if (n->norm() > 0.0) n->normalize();
+  };
+
+  // 制御点 idx[0 .. K) (P があれば P * idx) の正則パッチを (s, t) で評価する
+  void evalPatch(const FlatMesh& mesh, const int* idx, int K,
+                 const Eigen::MatrixXd* P, double s, double t,
+                 Eigen::Vector3d& p, Eigen::Vector3d* n) const {
+    const int ncp = (int)coef_.rows();
+    double b[MaxPatch], bs[MaxPatch], bt[MaxPatch];
+    basisAt(s, t, b, bs, bt);
+
+    // 正則パッチの制御点
+    Eigen::Vector3d Q[MaxPatch];
+    if (P != nullptr) {
+      for (int r = 0; r < ncp; ++r) Q[r].setZero();
+      for (int i = 0; i < K; ++i) {
+        const Eigen::Vector3d q = mesh.point(idx[i]);
+        const double* w = P->data() + (size_t)i * ncp;
+        for (int r = 0; r < ncp; ++r) Q[r] += w[r] * q;
+      }
+    } else {
+      for (int r = 0; r < ncp; ++r) Q[r] = mesh.point(idx[r]);
+    }
+
+    Eigen::Vector3d ds = Eigen::Vector3d::Zero(), dt = Eigen::Vector3d::Zero();
+    p.setZero();
+    for (int r = 0; r < ncp; ++r) {
+      p += b[r] * Q[r];
+      ds += bs[r] * Q[r];
+      dt += bt[r] * Q[r];
+    }
+    if (n == nullptr) return;
+    *n = ds.cross(dt);
+    if (n->norm() > 0.0) n->normalize();
+  };
+
+  // 正則パッチの基底 (と s, t による偏微分) の値
+  void basisAt(double s, double t, double* b, double* bs, double* bt) const {
+    double sp[MaxDegree + 1], tp[MaxDegree + 1];
+    sp[0] = tp[0] = 1.0;
+    for (int d = 1; d <= MaxDegree; ++d) {
+      sp[d] = sp[d - 1] * s;
+      tp[d] = tp[d - 1] * t;
+    }
+    const int nm = (int)mono_.size();
+    double m[MaxPatch], ms[MaxPatch], mt[MaxPatch];
+    for (int k = 0; k < nm; ++k) {
+      const int a = mono_[k].first, c = mono_[k].second;
+      m[k] = sp[a] * tp[c];
+      ms[k] = (a > 0) ? a * sp[a - 1] * tp[c] : 0.0;
+      mt[k] = (c > 0) ? c * sp[a] * tp[c - 1] : 0.0;
+    }
+    const int ncp = (int)coef_.rows();
+    for (int r = 0; r < ncp; ++r) b[r] = bs[r] = bt[r] = 0.0;
+    for (int k = 0; k < nm; ++k) {
+      const double* c = coef_.data() + (size_t)k * ncp;
+      for (int r = 0; r < ncp; ++r) {
+        b[r] += c[r] * m[k];
+        bs[r] += c[r] * ms[k];
+        bt[r] += c[r] * mt[k];
+      }
+    }
+  };
+
+  // 疎行列 S の部分行列 S(rows, cols)．cols の外に重みがあれば false
+  static bool subMatrix(const SubdivOperator::Matrix& S, const std::vector<int>& rows,
+                        const std::vector<int>& cols, Eigen::MatrixXd& M) {
+    std::vector<int> col(S.cols(), -1);
+    for (int j = 0; j < (int)cols.size(); ++j) col[cols[j]] = j;
+    M.setZero(rows.size(), cols.size());
+    for (int i = 0; i < (int)rows.size(); ++i) {
+      for (SubdivOperator::Matrix::InnerIterator it(S, rows[i]); it; ++it) {
+        if (col[it.col()] < 0) {
+          if (std::fabs(it.value()) > 1.0e-14) return false;
+          continue;
+        }
+        M(i, col[it.col()]) = it.value();
+      }
+    }
+    return true;
+  };
+
+  // 正則パッチの基底を求める．
+  // 正則格子を 2 回細分割し，面 0 内の格子点での極限点 (制御点の 1 次結合) を
+  // 多項式で補間する．
+  bool fitBasis() {
+    Scheme::monomials(mono_);
+    const int fs = Scheme::FaceSize;
+
+    FlatMesh wedge;
+    makeWedgeMesh(Scheme::RegularValence, fs, 5, wedge);
+    FlatTopology wtopo;
+    wtopo.build(wedge);
+    std::vector<int> G;
+    gatherPatch(wtopo, 0, G);
+
+    SubdivOperator op;
+    if (op.build<Kernel>(wedge, 2) == false) return false;
+    FlatMesh fine;
+    if (op.apply(wedge, fine) == false) return false;
+    FlatTopology ftopo;
+    ftopo.build(fine);
+
+    const Eigen::Vector3d c0 = wedge.point(wedge.face(0)[0]);
+    const Eigen::Vector3d c1 = wedge.point(wedge.face(0)[1]);
+    const Eigen::Vector3d c2 = wedge.point(wedge.face(0)[fs - 1]);
+
+    std::vector<std::pair<double, double> > st;
+    Scheme::samples(st);
+    const int ns = (int)st.size(), nm = (int)mono_.size();
+    Eigen::MatrixXd V(ns, nm), L(ns, G.size());
+    for (int i = 0; i < ns; ++i) {
+      const double s = st[i].first, t = st[i].second;
+      for (int k = 0; k < nm; ++k)
+        V(i, k) = std::pow(s, mono_[k].first) * std::pow(t, mono_[k].second);
+
+      // (s, t) にある細分割後の頂点
+      const Eigen::Vector3d q = c0 + s * (c1 - c0) + t * (c2 - c0);
+      int vi = 0;
+      for (int w = 1; w < fine.vertices_size(); ++w)
+        if ((fine.point(w) - q).norm() < (fine.point(vi) - q).norm()) vi = w;
+
+      // その頂点の極限点を元の制御点の 1 次結合で表す
+      Eigen::VectorXd row = Eigen::VectorXd::Zero(wedge.vertices_size());
+      Scheme::limitStencil(ftopo, vi, [&](int c, double w) {
+        for (SubdivOperator::Matrix::InnerIterator it(op.matrix(), c); it; ++it)
+          row[it.col()] += w * it.value();
+      });
+      for (int j = 0; j < (int)G.size(); ++j) L(i, j) = row[G[j]];
+      if (std::fabs(L.row(i).sum() - 1.0) > 1.0e-12) {
+        std::cerr << "Error: Cannot fit the regular patch basis. " << std::endl;
+        return false;
+      }
+    }
+    coef_ = V.colPivHouseholderQr().solve(L).transpose();
+    return true;
+  };
+
+  // valence n の特異頂点を角 0 に持つ面の表を作る
+  bool buildTable(int n, Table& table) const {
+    const int fs = Scheme::FaceSize;
+    FlatMesh wedge;
+    makeWedgeMesh(n, fs, 4, wedge);
+    FlatTopology t0, t1;
+    t0.build(wedge);
+
+    SubdivOperator op;
+    if (op.build<Kernel>(wedge, 1) == false) return false;
+    t1.build(op.topology());
+
+    // 面 0 の子 j は細分割後の面 j である (角 0 の子が j = 0)
+    std::vector<int> G0, G1;
+    gatherPatch(t0, 0, G0);
+    gatherPatch(t1, 0, G1);
+    Eigen::MatrixXd A, B[3];
+    bool ok = subMatrix(op.matrix(), G1, G0, A);
+    for (int j = 0; j < 3; ++j) {
+      std::vector<int> Gj;
+      gatherPatch(t1, (j + 1) * fs, Gj);
+      ok = ok && subMatrix(op.matrix(), Gj, G0, B[j]);
+    }
+    if (ok == false) {
+      std::cerr << "Error: Cannot build the subdivision matrix of valence " << n
+                << ". " << std::endl;
+      return false;
+    }
+
+    Eigen::MatrixXd Am = Eigen::MatrixXd::Identity(A.rows(), A.cols());
+    for (int j = 0; j < 3; ++j) table.P[j].resize(MaxDepth);
+    for (int m = 0; m < MaxDepth; ++m) {
+      for (int j = 0; j < 3; ++j) table.P[j][m] = B[j] * Am;
+      Am = A * Am;
+    }
+    return true;
+  };
+
+  FlatMesh mesh_;
+  FlatTopology topo_;
+  bool refined_;
+  FlatMesh fine_;
+  FlatTopology fine_topo_;
+
+  std::vector<int> ftype_;  // 評価に使うメッシュの面の種類
+  std::vector<int> patch_offset_;  // 面ごとの制御点 (CSR)
+  std::vector<int> patch_idx_;
+  std::map<int, Table> tables_;  // valence -> 表
+
+  // 正則パッチの基底: b_i(s, t) = sum_k coef_(i, k) s^a_k t^c_k
+  std::vector<std::pair<int, int> > mono_;
+  Eigen::MatrixXd coef_;
+};
+
+#endif  // _LIMITEVALUATOR_HXX
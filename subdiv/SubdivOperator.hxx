@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////
+//
+// Precomputed sparse subdivision operator (fine = S * coarse).
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _SUBDIVOPERATOR_HXX
+#define _SUBDIVOPERATOR_HXX 1
+
+#include <iostream>
+#include <vector>
+
+#include "myEigen.hxx"
+
+#include "FlatMesh.hxx"
+#include "ParallelFor.hxx"
+
+// SubdivOperator は，制御メッシュの位相が変わらないときに
+// level-k の細分割を疎行列 S として保持する．
+//
+//   fine = S * coarse   (fine: 細分割後の頂点 x 3, coarse: 制御頂点 x 3)
+//
+// build() で位相ごとに 1 回だけ S と細分割後の面を作っておけば，
+// 頂点位置だけが変わる場合 (アニメーションなど) は apply() の
+// 疎行列ベクトル積 1 回で細分割できる．接続関係の構築・ステンシルの重み・
+// beta の計算はすべて build() 側で済んでいる．
+//
+// Kernel には LoopSubFlat または CCSubFlat を指定する．
+class SubdivOperator {
+ public:
+  typedef Eigen::SparseMatrix<double, Eigen::RowMajor> Matrix;
+
+  SubdivOperator() : nthreads_(1), levels_(0){};
+  ~SubdivOperator(){};
+
+  // apply() のスレッド数
+  void setNumThreads(int n) { nthreads_ = (n > 0) ? n : 1; };
+  int numThreads() const { return nthreads_; };
+
+  const Matrix& matrix() const { return S_; };
+  int levels() const { return levels_; };
+  int rows() const { return (int)S_.rows(); };
+  int cols() const { return (int)S_.cols(); };
+  bool empty() const { return (S_.rows() == 0); };
+
+  // 細分割後の面 (頂点インデックス列)
+  const FlatMesh& topology() const { return fine_; };
+
+  // mesh の位相から level-levels の細分割行列を作る
+  template <class Kernel>
+  bool build(const FlatMesh& mesh, int levels) {
+    levels_ = 0;
+    S_.resize(0, 0);
+    if (levels < 1) return false;
+
+    FlatMesh cur, next;
+    cur.resize(mesh.vertices_size(), mesh.faces_size(), mesh.face_size());
+    cur.faces() = mesh.faces();
+
+    Kernel kernel;
+    kernel.setNumThreads(nthreads_);
+    for (int l = 0; l < levels; ++l) {
+      if (kernel.init(cur) == false) return false;
+
+      Matrix Sl;
+      levelMatrix(kernel, cur.vertices_size(), Sl);
+      if (l == 0)
+        S_ = Sl;
+      else
+        S_ = Matrix(Sl * S_);
+
+      kernel.setSplit(cur, next);
+      std::swap(cur, next);
+    }
+    S_.makeCompressed();
+
+    fine_.resize(cur.vertices_size(), cur.faces_size(), cur.face_size());
+    fine_.faces().swap(cur.faces());
+    levels_ = levels;
+    return true;
+  };
+
+  // 新しい制御頂点位置 coarse を細分割して fine に格納する．
+  // fine の頂点数が合わない場合は，細分割後の面もあわせて設定する．
+  // coarse の頂点数が build() したときと異なる場合は false を返す．
+  bool apply(const FlatMesh& coarse, FlatMesh& fine) const {
+    if (coarse.vertices_size() != cols()) {
+      std::cerr << "Error: The operator does not match the mesh. " << std::endl;
+      return false;
+    }
+    if (fine.vertices_size() != rows()) fine = fine_;
+
+    const double* x = coarse.coord(0);
+    const double* y = coarse.coord(1);
+    const double* z = coarse.coord(2);
+    double* fx = fine.coord(0);
+    double* fy = fine.coord(1);
+    double* fz = fine.coord(2);
+
+    const int* outer = S_.outerIndexPtr();
+    const int* inner = S_.innerIndexPtr();
+    const double* value = S_.valuePtr();
+    parallelFor(rows(), nthreads_, [&](int begin, int end) {
+      for (int r = begin; r < end; ++r) {
+        double px = 0.0, py = 0.0, pz = 0.0;
+        for (int j = outer[r]; j < outer[r + 1]; ++j) {
+          const int c = inner[j];
+          const double w = value[j];
+          px += w * x[c];
+          py += w * y[c];
+          pz += w * z[c];
+        }
+        fx[r] = px; fy[r] = py; fz[r] = pz;
+      }
+    });
+    return true;
+  };
+
+ private:
+  // 1 レベル分の細分割行列
+  template <class Kernel>
+  void levelMatrix(const Kernel& kernel, int nv, Matrix& Sl) const {
+    const int n = kernel.subVertices_size();
+    std::vector<Eigen::Triplet<double> > triplets;
+    triplets.reserve((size_t)n * 7);
+    for (int i = 0; i < n; ++i) {
+      kernel.stencil(i, [&](int c, double w) {
+        triplets.emplace_back(i, c, w);
+      });
+    }
+    Sl.resize(n, nv);
+    Sl.setFromTriplets(triplets.begin(), triplets.end());
+  };
+
+  Matrix S_;
+  FlatMesh fine_;
+  int nthreads_;
+  int levels_;
+};
+
+#endif  // _SUBDIVOPERATOR_HXX
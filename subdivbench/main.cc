@@ -0,0 +1,343 @@
+////////////////////////////////////////////////////////////////////
+//
+// Headless subdivision benchmark (per-phase timings in JSON).
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "envDep.h"
+#include "mydef.h"
+
+#include "CCSubL.hxx"
+#include "LoopAdaptive.hxx"
+#include "LoopSubL.hxx"
+#include "MeshL.hxx"
+#include "SMFLIO.hxx"
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// メモリ確保の回数とバイト数 (operator new を置き換えて数える)
+static std::atomic<long long> alloc_count(0);
+static std::atomic<long long> alloc_bytes(0);
+
+void* operator new(std::size_t n) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  alloc_bytes.fetch_add((long long)n, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// 1 つの処理段階の計測結果 (repeat 回のうち最短の時間)
+struct Phase {
+  std::string name;
+  double ms;
+  long long allocs;
+  long long bytes;
+};
+
+// 1 レベル分の細分割の計測結果
+struct Level {
+  Level() : level(0), vertices(0), faces(0), uniform_faces(-1){};
+  int level;
+  int vertices;
+  int faces;
+  int uniform_faces;  // adaptive: 同じレベルまでの一様な細分割の面数
+  std::vector<Phase> phases;
+};
+
+class PhaseTimer {
+ public:
+  PhaseTimer(std::vector<Phase>& phases) : phases_(phases), i_(0){};
+
+  // f を実行して name の段階として記録する．
+  // 2 回目以降の repeat では同じ順番の段階の最短時間を残す．
+  template <class F>
+  void run(const char* name, F&& f) {
+    const long long c0 = alloc_count.load(), b0 = alloc_bytes.load();
+    const auto t0 = std::chrono::steady_clock::now();
+    f();
+    const auto t1 = std::chrono::steady_clock::now();
+    const long long c1 = alloc_count.load(), b1 = alloc_bytes.load();
+    Phase p;
+    p.name = name;
+    p.ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    p.allocs = c1 - c0;
+    p.bytes = b1 - b0;
+    if (i_ < (int)phases_.size())
+      phases_[i_].ms = std::min(phases_[i_].ms, p.ms);
+    else
+      phases_.push_back(p);
+    ++i_;
+  };
+
+ private:
+  std::vector<Phase>& phases_;
+  int i_;
+};
+
+////////////////////////////////////////////////////////////////////////////////////
+
+// MeshL 上の細分割 (apply() と同じ段階を個別に計測する)
+// createConnectivity は init() (面の検査と createConnectivity()) の時間である．
+template <class Sub>
+static bool subdivideMeshL(Sub& sub, MeshL& submesh, PhaseTimer& timer) {
+  bool ok = true;
+  timer.run("createConnectivity", [&]() { ok = sub.init(); });
+  if (ok == false) return false;
+  timer.run("setSplit", [&]() { sub.setSplit(); });
+  timer.run("setStencil", [&]() { sub.setStencil(); });
+  timer.run("calcAllFaceNormals", [&]() { submesh.calcAllFaceNormals(); });
+  sub.clear();
+  return true;
+}
+
+// 配列上の細分割 (apply(levels) の 1 レベル分)
+template <class Kernel>
+static bool subdivideFlat(MeshL& mesh, MeshL& submesh, int fsize, int nthreads,
+                          PhaseTimer& timer) {
+  FlatMesh flat, subflat;
+  bool ok = true;
+  timer.run("flatFromMeshL", [&]() { ok = flatFromMeshL(mesh, fsize, flat); });
+  if (ok == false) return false;
+  timer.run("subdivide", [&]() {
+    Kernel kernel;
+    kernel.setNumThreads(nthreads);
+    ok = kernel.apply(flat, subflat, 1);
+  });
+  if (ok == false) return false;
+  timer.run("flatToMeshL", [&]() { flatToMeshL(subflat, submesh); });
+  timer.run("calcAllFaceNormals", [&]() { submesh.calcAllFaceNormals(); });
+  return true;
+}
+
+// 誤差による適応的な細分割 (LoopAdaptive) と，その最大レベルまでの一様な細分割
+// (LoopSubFlat) を計測する．lv の頂点数・面数は適応的な細分割の結果である
+static bool subdivideAdaptive(MeshL& mesh, int max_level, double tolerance, int nthreads,
+                              PhaseTimer& timer, Level& lv) {
+  FlatMesh flat, adaptflat, subflat;
+  bool ok = true;
+  timer.run("flatFromMeshL", [&]() { ok = flatFromMeshL(mesh, TRIANGLE, flat); });
+  if (ok == false) return false;
+  LoopAdaptive adaptive;
+  adaptive.setTolerance(tolerance);
+  adaptive.setMaxLevel(max_level);
+  timer.run("adaptive", [&]() { ok = adaptive.apply(flat, adaptflat); });
+  if (ok == false) return false;
+  timer.run("uniform", [&]() {
+    LoopSubFlat kernel;
+    kernel.setNumThreads(nthreads);
+    ok = kernel.apply(flat, subflat, adaptive.levels());
+  });
+  lv.level = adaptive.levels();
+  lv.vertices = adaptflat.vertices_size();
+  lv.faces = adaptflat.faces_size();
+  lv.uniform_faces = subflat.faces_size();
+  return ok;
+}
+
+static bool subdivide(const std::string& scheme, const std::string& path,
+                      std::shared_ptr<MeshL> mesh, std::shared_ptr<MeshL> submesh,
+                      int nthreads, PhaseTimer& timer) {
+  if (scheme == "loop") {
+    if (path == "flat")
+      return subdivideFlat<LoopSubFlat>(*mesh, *submesh, TRIANGLE, nthreads, timer);
+    LoopSub loopsub(mesh, submesh);
+    loopsub.setNumThreads(nthreads);
+    return subdivideMeshL(loopsub, *submesh, timer);
+  }
+  if (path == "flat")
+    return subdivideFlat<CCSubFlat>(*mesh, *submesh, RECTANGLE, nthreads, timer);
+  CCSubL ccsub(*mesh, *submesh);
+  ccsub.setNumThreads(nthreads);
+  return subdivideMeshL(ccsub, *submesh, timer);
+}
+
+static std::string jsonString(const std::string& s) {
+  std::string r = "\"";
+  for (char c : s) {
+    if ((c == '"') || (c == '\\')) r += '\\';
+    r += c;
+  }
+  return r + "\"";
+}
+
+static void usage(const char* prog) {
+  std::cerr << "Usage: " << prog
+            << " [-s loop|cc] [-p meshl|flat|adaptive] [-l levels] [-e tolerance]"
+               " [-t threads] [-r repeat]"
+               " [-o out.json] in.obj"
+            << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  std::string scheme = "loop";
+  std::string path = "meshl";
+  std::string input, output;
+  int levels = 1;
+  int nthreads = 1;
+  int repeat = 1;
+  double tolerance = 1.0e-3;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool has_arg = (i + 1 < argc);
+    if (!strcmp(argv[i], "-s") && has_arg) {
+      scheme = argv[++i];
+    } else if (!strcmp(argv[i], "-p") && has_arg) {
+      path = argv[++i];
+    } else if (!strcmp(argv[i], "-l") && has_arg) {
+      levels = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-e") && has_arg) {
+      tolerance = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-t") && has_arg) {
+      nthreads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-r") && has_arg) {
+      repeat = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && has_arg) {
+      output = argv[++i];
+    } else if ((argv[i][0] != '-') && input.empty()) {
+      input = argv[i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (input.empty() || ((scheme != "loop") && (scheme != "cc")) ||
+      ((path != "meshl") && (path != "flat") && (path != "adaptive")) ||
+      ((path == "adaptive") && (scheme != "loop")) || (levels < 1) || (repeat < 1)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  nthreads = std::max(1, nthreads);
+
+  // メッシュデータの読み込み
+  std::shared_ptr<MeshL> mesh0 = std::make_shared<MeshL>();
+  std::vector<Phase> load;
+  {
+    PhaseTimer timer(load);
+    bool ok = true;
+    timer.run("load", [&]() {
+      SMFLIO smflio;
+      smflio.setMesh(*mesh0);
+      ok = smflio.inputFromFile(input.c_str());
+      if (ok) mesh0->createConnectivity(true);
+    });
+    if (ok == false) return EXIT_FAILURE;
+  }
+
+  // repeat 回細分割して，段階ごとに最短の時間を残す．
+  // meshl の setSplit() / setStencil() は演習のコードなので，埋められていなければ
+  // 面のないメッシュができる．その場合は警告を出し，次のレベルは計測しない
+  // adaptive は -l を最大レベルとして 1 回の細分割を 1 つのレベルとして出力する
+  std::vector<Level> result(levels);
+  std::string warning;
+  const int max_level = levels;
+  if (path == "adaptive") {
+    levels = 1;
+    result.resize(1);
+  }
+  for (int r = 0; (path == "adaptive") && (r < repeat); ++r) {
+    PhaseTimer timer(result[0].phases);
+    if (subdivideAdaptive(*mesh0, max_level, tolerance, nthreads, timer,
+                          result[0]) == false) {
+      std::cerr << "Error: adaptive subdivision failed. " << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  for (int r = 0; (path != "adaptive") && (r < repeat); ++r) {
+    std::shared_ptr<MeshL> mesh = mesh0;
+    for (int l = 0; l < levels; ++l) {
+      std::shared_ptr<MeshL> submesh = std::make_shared<MeshL>();
+      PhaseTimer timer(result[l].phases);
+      if (subdivide(scheme, path, mesh, submesh, nthreads, timer) == false) {
+        std::cerr << "Error: subdivision failed at level " << l + 1 << ". "
+                  << std::endl;
+        return EXIT_FAILURE;
+      }
+      result[l].level = l + 1;
+      result[l].vertices = submesh->vertices_size();
+      result[l].faces = submesh->faces_size();
+      mesh = submesh;
+      if (submesh->faces_size() == 0) {
+        warning = "level " + std::to_string(l + 1) +
+                  " has no faces (setSplit() is not implemented?)";
+        levels = l + 1;
+        result.resize(levels);
+        break;
+      }
+    }
+  }
+  if (!warning.empty()) std::cerr << "Warning: " << warning << ". " << std::endl;
+
+  // JSON 出力
+  std::ostringstream js;
+  double total = 0.0;
+  js << "{\n";
+  js << "  \"input\": " << jsonString(input) << ",\n";
+  js << "  \"scheme\": " << jsonString(scheme) << ",\n";
+  js << "  \"path\": " << jsonString(path) << ",\n";
+  js << "  \"threads\": " << nthreads << ",\n";
+  js << "  \"repeat\": " << repeat << ",\n";
+  js << "  \"vertices\": " << mesh0->vertices_size() << ",\n";
+  js << "  \"faces\": " << mesh0->faces_size() << ",\n";
+  js << "  \"load_ms\": " << load[0].ms << ",\n";
+  if (path == "adaptive") js << "  \"tolerance\": " << tolerance << ",\n";
+  if (!warning.empty()) js << "  \"warning\": " << jsonString(warning) << ",\n";
+  js << "  \"levels\": [\n";
+  for (int l = 0; l < levels; ++l) {
+    const Level& lv = result[l];
+    js << "    {\"level\": " << lv.level << ", \"vertices\": " << lv.vertices
+       << ", \"faces\": " << lv.faces;
+    if (lv.uniform_faces >= 0) js << ", \"uniform_faces\": " << lv.uniform_faces;
+    js << ", \"phases\": {\n";
+    for (int i = 0; i < (int)lv.phases.size(); ++i) {
+      const Phase& p = lv.phases[i];
+      total += p.ms;
+      js << "      " << jsonString(p.name) << ": {\"ms\": " << p.ms
+         << ", \"allocs\": " << p.allocs << ", \"bytes\": " << p.bytes << "}"
+         << ((i + 1 < (int)lv.phases.size()) ? ",\n" : "\n");
+    }
+    js << "    }}" << ((l + 1 < levels) ? ",\n" : "\n");
+  }
+  js << "  ],\n";
+  js << "  \"total_ms\": " << total << "\n";
+  js << "}\n";
+
+  if (output.empty()) {
+    std::cout << js.str();
+  } else {
+    FILE* fp = fopen(output.c_str(), "w");
+    if (fp == nullptr) {
+      std::cerr << "Error: cannot open " << output << ". " << std::endl;
+      return EXIT_FAILURE;
+    }
+    fputs(js.str().c_str(), fp);
+    fclose(fp);
+  }
+  return EXIT_SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////
+//
+// Out-of-core streaming subdivision to OBJ or FLATSUB1 files.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "envDep.h"
+#include "mydef.h"
+
+#include "CCSubFlat.hxx"
+#include "FlatMeshL.hxx"
+#include "FlatStream.hxx"
+#include "LoopSubFlat.hxx"
+#include "MeshL.hxx"
+#include "SMFLIO.hxx"
+
+////////////////////////////////////////////////////////////////////////////////////
+
+template <class Kernel>
+static bool stream(const FlatMesh& mesh, int levels, size_t budget, int nthreads,
+                   const std::string& output, bool obj) {
+  FlatStream<Kernel> st;
+  st.setMemoryBudget(budget);
+  st.setNumThreads(nthreads);
+  const auto t0 = std::chrono::steady_clock::now();
+  if (st.apply(mesh, levels, output,
+               obj ? FlatStream<Kernel>::OBJ : FlatStream<Kernel>::BINARY) == false)
+    return false;
+  const auto t1 = std::chrono::steady_clock::now();
+  const FlatStreamStats& s = st.stats();
+  std::cout << "stream subdiv. (level " << levels << "): done. v " << s.vertices << " f "
+            << s.faces << " clusters " << s.clusters << " (max " << s.max_cluster_faces
+            << " faces, " << s.max_local_faces << " with halo) peak "
+            << s.peak_bytes / (1024.0 * 1024.0) << " MB / budget "
+            << budget / (1024.0 * 1024.0) << " MB, "
+            << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms"
+            << std::endl;
+  return true;
+}
+
+static void usage(const char* prog) {
+  std::cerr << "Usage: " << prog
+            << " [-s loop|cc] [-l levels] [-m budget_mb] [-t threads] in.obj"
+               " out.obj|out.fsub"
+            << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+  std::string scheme = "loop";
+  std::string input, output;
+  int levels = 3;
+  int budget_mb = 256;
+  int nthreads = 1;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool has_arg = (i + 1 < argc);
+    if (!strcmp(argv[i], "-s") && has_arg) {
+      scheme = argv[++i];
+    } else if (!strcmp(argv[i], "-l") && has_arg) {
+      levels = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-m") && has_arg) {
+      budget_mb = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-t") && has_arg) {
+      nthreads = atoi(argv[++i]);
+    } else if ((argv[i][0] != '-') && input.empty()) {
+      input = argv[i];
+    } else if ((argv[i][0] != '-') && output.empty()) {
+      output = argv[i];
+    } else {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (input.empty() || output.empty() || ((scheme != "loop") && (scheme != "cc")) ||
+      (levels < 1) || (budget_mb < 1)) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  // 拡張子が .obj なら OBJ，それ以外は FLATSUB1 で出力する
+  const bool obj = (output.size() > 4) && (output.substr(output.size() - 4) == ".obj");
+
+  // メッシュデータの読み込み (入力はメモリに置く)
+  FlatMesh mesh;
+  {
+    MeshL meshl;
+    SMFLIO smflio;
+    smflio.setMesh(meshl);
+    if (smflio.inputFromFile(input.c_str()) == false) return EXIT_FAILURE;
+    const int fsize = (scheme == "loop") ? TRIANGLE : RECTANGLE;
+    if (flatFromMeshL(meshl, fsize, mesh) == false) return EXIT_FAILURE;
+  }
+
+  const size_t budget = (size_t)budget_mb * 1024 * 1024;
+  const bool ok = (scheme == "loop")
+                      ? stream<LoopSubFlat>(mesh, levels, budget, nthreads, output, obj)
+                      : stream<CCSubFlat>(mesh, levels, budget, nthreads, output, obj);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
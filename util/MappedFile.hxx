@@ -0,0 +1,88 @@
+////////////////////////////////////////////////////////////////////
+//
+// Read-only memory-mapped file.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _MAPPEDFILE_HXX
+#define _MAPPEDFILE_HXX 1
+
+#include <cstddef>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ファイル全体を読み込み専用でメモリにマップする．
+// ページは触れたときに OS が読み込むので，open() はファイルの大きさによらずすぐ終わる．
+// コピーはできない (複数のオブジェクトで共有するときは std::shared_ptr で持つ)
+class MappedFile {
+ public:
+  MappedFile() : data_(nullptr), size_(0) {};
+  ~MappedFile() { close(); };
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // 空のファイルや開けないファイルは false
+  bool open(const char* filename) {
+    close();
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE map = nullptr;
+    if (GetFileSizeEx(file, &size) && (size.QuadPart > 0))
+      map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (map == nullptr) return false;
+    void* p = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(map);
+    if (p == nullptr) return false;
+    data_ = p;
+    size_ = (size_t)size.QuadPart;
+#else
+    const int fd = ::open(filename, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void* p = MAP_FAILED;
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0))
+      p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);  // マップはファイルを閉じても残る
+    if (p == MAP_FAILED) return false;
+    data_ = p;
+    size_ = (size_t)st.st_size;
+#endif
+    return true;
+  };
+
+  void close() {
+    if (data_ == nullptr) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+#else
+    munmap(data_, size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  };
+
+  bool isOpen() const { return data_ != nullptr; };
+  const char* data() const { return (const char*)data_; };
+  size_t size() const { return size_; };
+
+ private:
+  void* data_;
+  size_t size_;
+};
+
+#endif  // _MAPPEDFILE_HXX
@@ -0,0 +1,48 @@
+////////////////////////////////////////////////////////////////////
+//
+// Simple static-partition parallel loop on std::thread.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _PARALLELFOR_HXX
+#define _PARALLELFOR_HXX 1
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// 使用可能なスレッド数 (取得できない場合は 1)
+inline int hardwareThreads() {
+  unsigned int n = std::thread::hardware_concurrency();
+  return (n > 0) ? (int)n : 1;
+}
+
+// [0, n) を連続した区間に分割し，f(begin, end) を nthreads 個のスレッドで呼ぶ．
+// - 区間の分け方は n と nthreads だけで決まるので，各要素の計算が独立なら
+//   結果はスレッド数によらず同じになる
+// - grain より小さい区間には分割しない
+template <class F>
+inline void parallelFor(int n, int nthreads, F&& f, int grain = 1024) {
+  if (n <= 0) return;
+  if (grain < 1) grain = 1;
+  nthreads = std::min(nthreads, (n + grain - 1) / grain);
+  if (nthreads <= 1) {
+    f(0, n);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  threads.reserve(nthreads - 1);
+  for (int t = 1; t < nthreads; ++t) {
+    const int begin = (int)((long long)n * t / nthreads);
+    const int end = (int)((long long)n * (t + 1) / nthreads);
+    threads.emplace_back([&f, begin, end]() { f(begin, end); });
+  }
+  f(0, (int)((long long)n / nthreads));
+  for (auto& th : threads) th.join();
+}
+
+#endif  // _PARALLELFOR_HXX
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////
+//
+// Small work-stealing task pool on std::thread.
+//
+// Copyright (c) 2026 Takashi Kanai
+// Released under the MIT license
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef _TASKPOOL_HXX
+#define _TASKPOOL_HXX 1
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// TaskPool は，実行中のタスクが spawn() で新しいタスクを追加できるスレッドプールである．
+// - スレッドごとに deque を持ち，自分の deque は後ろから (最後に追加したものから) 取り出す
+// - 自分の deque が空なら，ほかのスレッドの deque の前から (古いものから) 盗む
+// - run() は呼び出したスレッドも含めた nthreads 個のスレッドで実行し，
+//   すべてのタスクが終わるまで戻らない
+// 再帰的に区間を分割する処理では，古いタスクほど大きいので，盗まれるのは大きなタスクになる．
+class TaskPool {
+ public:
+  typedef std::function<void()> Task;
+
+  explicit TaskPool(int nthreads) : nthreads_((nthreads > 0) ? nthreads : 1), pending_(0) {
+    for (int i = 0; i < nthreads_; ++i) queues_.emplace_back(new Queue);
+  };
+  ~TaskPool(){};
+
+  int numThreads() const { return nthreads_; };
+
+  // root と，そこから spawn() されたタスクをすべて実行する
+  void run(Task root) {
+    pending_ = 1;
+    queues_[0]->tasks.push_back(std::move(root));
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads_ - 1);
+    for (int w = 1; w < nthreads_; ++w) threads.emplace_back([this, w]() { work(w); });
+    work(0);
+    for (auto& th : threads) th.join();
+  };
+
+  // 実行中のタスクから呼ぶ: 呼び出したスレッドの deque にタスクを追加する
+  void spawn(Task task) {
+    pending_.fetch_add(1);
+    Queue& q = *queues_[worker()];
+    std::lock_guard<std::mutex> lock(q.m);
+    q.tasks.push_back(std::move(task));
+  };
+
+ private:
+  struct Queue {
+    std::mutex m;
+    std::deque<Task> tasks;
+  };
+
+  // 呼び出したスレッドのワーカー番号
+  static int& worker() {
+    thread_local int w = 0;
+    return w;
+  };
+
+  void work(int w) {
+    worker() = w;
+    Task task;
+    while (pending_.load() > 0) {
+      if (pop(w, task) || steal(w, task)) {
+        task();
+        task = nullptr;
+        pending_.fetch_sub(1);
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  };
+
+  bool pop(int w, Task& task) {
+    Queue& q = *queues_[w];
+    std::lock_guard<std::mutex> lock(q.m);
+    if (q.tasks.empty()) return false;
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    return true;
+  };
+
+  bool steal(int w, Task& task) {
+    for (int i = 1; i < nthreads_; ++i) {
+      Queue& q = *queues_[(w + i) % nthreads_];
+      std::lock_guard<std::mutex> lock(q.m);
+      if (q.tasks.empty()) continue;
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+      return true;
+    }
+    return false;
+  };
+
+  int nthreads_;
+  std::vector<std::unique_ptr<Queue> > queues_;
+  std::atomic<int> pending_;
+};
+
+#endif  // _TASKPOOL_HXX